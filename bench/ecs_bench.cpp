@@ -0,0 +1,305 @@
+#include "boa/ecs/ecs.h"
+#include "boa/utl/iteration.h"
+#include "boa/utl/thread_pool.h"
+#include <fmt/format.h>
+#include <fmt/os.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ECS micro-benchmarks, runs without a window or GPU.
+//
+//   boa_ecs_bench [--format csv|json] [--output FILE] [--sizes 1000,100000]
+//                 [--repeat N]
+//
+// Every benchmark is run `repeat` times on a fresh entity group and the
+// fastest and median run are reported as nanoseconds per operation.
+
+using namespace boa;
+using namespace boa::ecs;
+
+namespace {
+
+struct Position {
+    Position() {}
+    Position(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    float x{ 0.0f }, y{ 0.0f }, z{ 0.0f };
+};
+
+struct Velocity {
+    Velocity() {}
+    Velocity(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    float x{ 0.0f }, y{ 0.0f }, z{ 0.0f };
+};
+
+struct Health {
+    Health() {}
+    Health(int32_t value_) : value(value_) {}
+    int32_t value{ 100 };
+};
+
+// roughly the size of a transform matrix, to stand in for heavier components
+struct Payload {
+    Payload() {}
+    Payload(float seed) { std::fill(std::begin(data), std::end(data), seed); }
+    float data[16]{};
+};
+
+enum class Mix {
+    One,
+    Two,
+    Four,
+};
+
+const char *mix_name(Mix mix) {
+    switch (mix) {
+    case Mix::One:
+        return "position";
+    case Mix::Two:
+        return "position+velocity";
+    case Mix::Four:
+    default:
+        return "position+velocity+health+payload";
+    }
+}
+
+void make_components(EntityGroup &entity_group, uint32_t e_id, Mix mix) {
+    float f = static_cast<float>(entity_index(e_id));
+    entity_group.enable_and_make<Position>(e_id, f, f, f);
+    if (mix == Mix::One)
+        return;
+    entity_group.enable_and_make<Velocity>(e_id, 1.0f, 0.0f, 0.0f);
+    if (mix == Mix::Two)
+        return;
+    entity_group.enable_and_make<Health>(e_id, 100);
+    entity_group.enable_and_make<Payload>(e_id, f);
+}
+
+std::vector<uint32_t> populate(EntityGroup &entity_group, uint32_t count, Mix mix) {
+    std::vector<uint32_t> e_ids(count);
+    for (uint32_t &e_id : e_ids) {
+        e_id = entity_group.new_entity();
+        make_components(entity_group, e_id, mix);
+    }
+    return e_ids;
+}
+
+// keeps results alive so loops are not optimized out
+volatile uint64_t sink = 0;
+
+struct Result {
+    std::string name;
+    std::string mix;
+    uint32_t entities;
+    uint64_t operations;
+    double min_ns_per_op;
+    double median_ns_per_op;
+};
+
+struct Benchmark {
+    std::string name;
+    // false when the component mix does not affect what is measured
+    bool uses_mix;
+    // prepares state outside the timed region, then returns the timed body
+    std::function<std::function<uint64_t()>(EntityGroup &, uint32_t, Mix)> setup;
+};
+
+std::vector<Benchmark> make_benchmarks() {
+    std::vector<Benchmark> benchmarks;
+
+    benchmarks.push_back({ "new_entity", false, [](EntityGroup &entity_group, uint32_t count, Mix) {
+        return [&entity_group, count]() {
+            for (uint32_t i = 0; i < count; i++)
+                sink = sink + entity_group.new_entity();
+            return uint64_t(count);
+        };
+    } });
+
+    benchmarks.push_back({ "enable_and_make", true, [](EntityGroup &entity_group, uint32_t count, Mix mix) {
+        auto e_ids = std::make_shared<std::vector<uint32_t>>(count);
+        for (uint32_t &e_id : *e_ids)
+            e_id = entity_group.new_entity();
+        return [&entity_group, e_ids, mix]() {
+            for (uint32_t e_id : *e_ids)
+                make_components(entity_group, e_id, mix);
+            return uint64_t(e_ids->size());
+        };
+    } });
+
+    benchmarks.push_back({ "get_component", true, [](EntityGroup &entity_group, uint32_t count, Mix mix) {
+        auto e_ids = std::make_shared<std::vector<uint32_t>>(populate(entity_group, count, mix));
+        return [&entity_group, e_ids]() {
+            const EntityGroup &reader = entity_group;
+            float total = 0.0f;
+            for (uint32_t e_id : *e_ids)
+                total += reader.get_component<Position>(e_id).x;
+            sink = sink + static_cast<uint64_t>(total);
+            return uint64_t(e_ids->size());
+        };
+    } });
+
+    benchmarks.push_back({ "for_each_entity_with_component", true, [](EntityGroup &entity_group, uint32_t count, Mix mix) {
+        populate(entity_group, count, mix);
+        // built outside the timed region, like it is after the first frame
+        entity_group.view<Position, Velocity>();
+        return [&entity_group]() {
+            uint64_t visited = 0;
+            entity_group.for_each_entity_with_component<Position, Velocity>([&](uint32_t e_id) {
+                auto &position = entity_group.get_component<Position>(e_id);
+                const auto &velocity = std::as_const(entity_group).get_component<Velocity>(e_id);
+                position.x += velocity.x;
+                visited++;
+                return Iteration::Continue;
+            });
+            sink = sink + visited;
+            return std::max<uint64_t>(visited, 1);
+        };
+    } });
+
+    benchmarks.push_back({ "copy_entity", true, [](EntityGroup &entity_group, uint32_t count, Mix mix) {
+        uint32_t prototype = entity_group.new_entity();
+        make_components(entity_group, prototype, mix);
+        return [&entity_group, prototype, count]() {
+            for (uint32_t i = 0; i < count; i++)
+                sink = sink + entity_group.copy_entity(prototype);
+            return uint64_t(count);
+        };
+    } });
+
+    benchmarks.push_back({ "delete_entity", true, [](EntityGroup &entity_group, uint32_t count, Mix mix) {
+        auto e_ids = std::make_shared<std::vector<uint32_t>>(populate(entity_group, count, mix));
+        return [&entity_group, e_ids]() {
+            for (uint32_t e_id : *e_ids)
+                entity_group.delete_entity(e_id);
+            return uint64_t(e_ids->size());
+        };
+    } });
+
+    return benchmarks;
+}
+
+Result run_benchmark(EntityGroup &entity_group, const Benchmark &benchmark, uint32_t count, Mix mix, uint32_t repeat) {
+    std::vector<double> samples;
+    uint64_t operations = 0;
+
+    for (uint32_t run = 0; run < repeat; run++) {
+        entity_group.clear_entities();
+        auto body = benchmark.setup(entity_group, count, mix);
+
+        auto start_time = std::chrono::steady_clock::now();
+        operations = body();
+        auto stop_time = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(stop_time - start_time).count();
+        samples.push_back(ns / operations);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return Result{ benchmark.name, benchmark.uses_mix ? mix_name(mix) : "none", count, operations, samples.front(), samples[samples.size() / 2] };
+}
+
+std::vector<uint32_t> parse_sizes(const std::string &list) {
+    std::vector<uint32_t> sizes;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        sizes.push_back(std::stoul(list.substr(start, end - start)));
+        start = end + 1;
+    }
+    return sizes;
+}
+
+void write_csv(std::FILE *out, const std::vector<Result> &results) {
+    fmt::print(out, "benchmark,mix,entities,operations,min_ns_per_op,median_ns_per_op\n");
+    for (const auto &result : results) {
+        fmt::print(out, "{},{},{},{},{:.3f},{:.3f}\n", result.name, result.mix, result.entities,
+            result.operations, result.min_ns_per_op, result.median_ns_per_op);
+    }
+}
+
+void write_json(std::FILE *out, const std::vector<Result> &results) {
+    fmt::print(out, "{{\n  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &result = results[i];
+        fmt::print(out, "    {{ \"benchmark\": \"{}\", \"mix\": \"{}\", \"entities\": {}, \"operations\": {}, "
+                        "\"min_ns_per_op\": {:.3f}, \"median_ns_per_op\": {:.3f} }}{}\n",
+            result.name, result.mix, result.entities, result.operations,
+            result.min_ns_per_op, result.median_ns_per_op, i + 1 < results.size() ? "," : "");
+    }
+    fmt::print(out, "  ]\n}}\n");
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::string format = "csv";
+    std::string output_path;
+    std::vector<uint32_t> sizes = { 1000, 100000, 1000000 };
+    uint32_t repeat = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--format") && has_value) {
+            format = argv[++i];
+        } else if (!strcmp(argv[i], "--output") && has_value) {
+            output_path = argv[++i];
+        } else if (!strcmp(argv[i], "--sizes") && has_value) {
+            sizes = parse_sizes(argv[++i]);
+        } else if (!strcmp(argv[i], "--repeat") && has_value) {
+            repeat = std::max(1ul, std::stoul(argv[++i]));
+        } else {
+            fmt::print(stderr, "Usage: {} [--format csv|json] [--output FILE] [--sizes 1000,100000] [--repeat N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (format != "csv" && format != "json") {
+        fmt::print(stderr, "Unknown format '{}'\n", format);
+        return 1;
+    }
+
+    ThreadPool thread_pool;
+    ComponentStore component_store;
+    EntityGroup entity_group;
+
+    std::vector<Result> results;
+    for (const auto &benchmark : make_benchmarks()) {
+        for (Mix mix : { Mix::One, Mix::Two, Mix::Four }) {
+            if (!benchmark.uses_mix && mix != Mix::One)
+                continue;
+            // the two component query needs at least two components
+            if (benchmark.name == "for_each_entity_with_component" && mix == Mix::One)
+                continue;
+            for (uint32_t count : sizes)
+                results.push_back(run_benchmark(entity_group, benchmark, count, mix, repeat));
+        }
+    }
+    entity_group.clear_entities();
+
+    std::FILE *out = stdout;
+    if (!output_path.empty()) {
+        out = std::fopen(output_path.c_str(), "w");
+        if (!out) {
+            fmt::print(stderr, "Failed to open '{}'\n", output_path);
+            return 1;
+        }
+    }
+
+    if (format == "json")
+        write_json(out, results);
+    else
+        write_csv(out, results);
+
+    if (out != stdout)
+        std::fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#ifndef BOA_ECS_COMMAND_BUFFER_H
+#define BOA_ECS_COMMAND_BUFFER_H
+
+#include "boa/utl/macros.h"
+#include "boa/ecs/entity.h"
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <utility>
+
+namespace boa::ecs {
+
+// entity created by a CommandBuffer, only meaningful within that buffer
+struct PendingEntity {
+    uint32_t index;
+};
+
+// Records structural changes so they can be made while the entity group is
+// being iterated (or from several threads, one buffer each) and applied
+// later at a sync point. Playback runs in phases:
+//   1. creations, in recorded order
+//   2. enable/make/disable, grouped by component type then entity, keeping
+//      the recorded order for any one entity and component
+//   3. callbacks, in recorded order
+//   4. deletions, which win over anything else recorded for the entity
+// Commands for entities that no longer exist when applied are dropped.
+class CommandBuffer {
+public:
+    CommandBuffer() {}
+    REMOVE_COPY_AND_ASSIGN(CommandBuffer);
+    CommandBuffer(CommandBuffer &&) = default;
+    CommandBuffer &operator=(CommandBuffer &&) = default;
+
+    PendingEntity create() {
+        return { m_create_count++ };
+    }
+
+    template <typename C>
+    void enable(uint32_t e_id) {
+        record<EnableOperation<C>>(Target{ e_id, false });
+    }
+
+    template <typename C>
+    void enable(PendingEntity pending) {
+        record<EnableOperation<C>>(Target{ pending.index, true });
+    }
+
+    // enables the component if needed, like EntityGroup::enable_and_make
+    template <typename C, typename ...Args>
+    void make(uint32_t e_id, Args &&...args) {
+        record<MakeOperation<C>>(Target{ e_id, false }, C(std::forward<Args>(args)...));
+    }
+
+    template <typename C, typename ...Args>
+    void make(PendingEntity pending, Args &&...args) {
+        record<MakeOperation<C>>(Target{ pending.index, true }, C(std::forward<Args>(args)...));
+    }
+
+    template <typename C>
+    void disable(uint32_t e_id) {
+        record<DisableOperation<C>>(Target{ e_id, false });
+    }
+
+    void delete_entity(uint32_t e_id) {
+        m_deletions.push_back(Target{ e_id, false });
+    }
+
+    void delete_entity(PendingEntity pending) {
+        m_deletions.push_back(Target{ pending.index, true });
+    }
+
+    // for changes outside the ECS that have to happen at the sync point
+    void call(std::function<void()> &&callback) {
+        m_callbacks.push_back(std::move(callback));
+    }
+
+    bool empty() const {
+        return m_create_count == 0 && m_operations.empty() && m_callbacks.empty() && m_deletions.empty();
+    }
+
+    void apply(EntityGroup &entity_group);
+    void clear();
+
+private:
+    struct Target {
+        uint32_t id;
+        bool pending;
+    };
+
+    struct Operation {
+        virtual ~Operation() {}
+        virtual void apply(EntityGroup &entity_group, uint32_t e_id) = 0;
+    };
+
+    template <typename C>
+    struct EnableOperation : Operation {
+        using Component = C;
+
+        void apply(EntityGroup &entity_group, uint32_t e_id) override {
+            entity_group.enable<C>(e_id);
+        }
+    };
+
+    template <typename C>
+    struct MakeOperation : Operation {
+        using Component = C;
+
+        MakeOperation(C &&component_)
+            : component(std::move(component_))
+        {
+        }
+
+        void apply(EntityGroup &entity_group, uint32_t e_id) override {
+            entity_group.enable_and_make<C>(e_id, std::move(component));
+        }
+
+        C component;
+    };
+
+    template <typename C>
+    struct DisableOperation : Operation {
+        using Component = C;
+
+        void apply(EntityGroup &entity_group, uint32_t e_id) override {
+            entity_group.disable<C>(e_id);
+        }
+    };
+
+    struct ComponentCommand {
+        uint32_t c_id;
+        Target target;
+        std::unique_ptr<Operation> operation;
+    };
+
+    template <typename O, typename ...Args>
+    void record(Target target, Args &&...args) {
+        m_operations.push_back(ComponentCommand{
+            component_id<typename O::Component>(),
+            target,
+            std::make_unique<O>(std::forward<Args>(args)...),
+        });
+    }
+
+    uint32_t m_create_count{ 0 };
+    std::vector<ComponentCommand> m_operations;
+    std::vector<std::function<void()>> m_callbacks;
+    std::vector<Target> m_deletions;
+};
+
+// One CommandBuffer per ThreadPool thread, so systems running on the pool
+// can record without locking. Flushed once per frame by the engine.
+class CommandQueue {
+public:
+    explicit CommandQueue(uint32_t thread_count);
+    REMOVE_COPY_AND_ASSIGN(CommandQueue);
+    static CommandQueue &get();
+
+    // buffer of the calling thread
+    CommandBuffer &local();
+
+    // applies every buffer in thread order and clears them
+    void flush(EntityGroup &entity_group);
+
+private:
+    std::vector<CommandBuffer> m_buffers;
+};
+
+}
+
+#endif
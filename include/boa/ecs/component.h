@@ -2,63 +2,652 @@
 #define BOA_ECS_COMPONENT_H
 
 #include "boa/utl/macros.h"
+#include "boa/ecs/component_mask.h"
+#include "boa/ecs/handle.h"
+#include "boa/ecs/snapshot.h"
 #include <cstdint>
 #include <memory>
+#include <algorithm>
+#include <vector>
+#include <array>
+#include <limits>
+#include <utility>
+#include <tuple>
+#include <functional>
 #include <stdexcept>
+#include <type_traits>
 
 namespace boa::ecs {
 
-const size_t COMPONENTS_START_COUNT = 32;
-//const size_t COMPONENT_ZONE_SIZE = 32 * KiB;
-const size_t COMPONENT_ZONE_SIZE = 64 * KiB;
-const uint32_t COMPONENTS_GROWTH_RATE = 2;
+const uint32_t COMPONENT_PAGE_CAPACITY = 256;
+const uint32_t SPARSE_PAGE_CAPACITY = 4096;
 
 extern uint32_t component_type_count;
 
+uint32_t next_component_id();
+
 template <typename T>
 uint32_t component_id();
 
+// Entity -> uint32_t map stored in lazily allocated pages, so slots
+// that never get an entry cost nothing beyond their page pointer. Keyed by
+// entity slot; callers that care about stale handles compare generations.
+class SparseIndex {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    uint32_t get(uint32_t e_id) const {
+        uint32_t index = entity_index(e_id);
+        uint32_t page = index / SPARSE_PAGE_CAPACITY;
+        if (page >= m_pages.size() || !m_pages[page])
+            return NONE;
+        return m_pages[page][index % SPARSE_PAGE_CAPACITY];
+    }
+
+    void set(uint32_t e_id, uint32_t value) {
+        uint32_t index = entity_index(e_id);
+        uint32_t page = index / SPARSE_PAGE_CAPACITY;
+        if (page >= m_pages.size())
+            m_pages.resize(page + 1);
+        if (!m_pages[page]) {
+            m_pages[page] = std::make_unique<uint32_t[]>(SPARSE_PAGE_CAPACITY);
+            std::fill_n(m_pages[page].get(), SPARSE_PAGE_CAPACITY, NONE);
+        }
+        m_pages[page][index % SPARSE_PAGE_CAPACITY] = value;
+    }
+
+    // only valid for ids that have an entry
+    void reset(uint32_t e_id) {
+        uint32_t index = entity_index(e_id);
+        m_pages[index / SPARSE_PAGE_CAPACITY][index % SPARSE_PAGE_CAPACITY] = NONE;
+    }
+
+    void clear() {
+        m_pages.clear();
+    }
+
+private:
+    std::vector<std::unique_ptr<uint32_t[]>> m_pages;
+};
+
+// Registered through ComponentStore::register_serializer for components
+// that can not be snapshot as raw bytes.
+template <typename Component>
+using ComponentSaver = std::function<void(const Component &, SnapshotWriter &)>;
+
+template <typename Component>
+using ComponentLoader = std::function<Component(SnapshotReader &)>;
+
+// Sparse set: the sparse index maps an entity id to a slot in the packed
+// arrays, so memory scales with the number of owners rather than ids.
+// Both the index and the components live in fixed-size pages that are
+// never moved; removing a component leaves a hole that the next insert
+// reuses, so component addresses stay valid until the component is removed.
+// Every slot also remembers the store version it was last changed in.
+class ComponentPoolBase {
+public:
+    static constexpr uint32_t NO_COMPONENT = SparseIndex::NONE;
+
+    explicit ComponentPoolBase(const uint32_t &version)
+        : m_version(version)
+    {
+    }
+
+    virtual ~ComponentPoolBase() {}
+
+    virtual void remove(uint32_t e_id) = 0;
+    virtual void copy(uint32_t from_e_id, uint32_t to_e_id) = 0;
+    // copies one component to `count` consecutive entities starting at `first_e_id`
+    virtual void copy_to_range(uint32_t from_e_id, uint32_t first_e_id, uint32_t count) = 0;
+    virtual void clear() = 0;
+    // Restoring replaces every component of the pool and stamps all of them
+    // with the current version, so change tracking sees a restore as changes.
+    virtual void save(SnapshotWriter &writer) const = 0;
+    virtual void restore(SnapshotReader &reader) = 0;
+
+    bool contains(uint32_t e_id) const {
+        uint32_t slot = slot_of(e_id);
+        return slot != NO_COMPONENT && m_dense_entities[slot] == e_id;
+    }
+
+    size_t size() const {
+        return m_dense_entities.size() - m_free_slots.size();
+    }
+
+    // slot-ordered owners, holes are NO_COMPONENT
+    const std::vector<uint32_t> &entities() const {
+        return m_dense_entities;
+    }
+
+    // slot-ordered change versions, parallel to entities()
+    const std::vector<uint32_t> &versions() const {
+        return m_versions;
+    }
+
+    void mark_changed(uint32_t e_id) {
+        m_versions[slot_of(e_id)] = m_version;
+    }
+
+    uint32_t changed_version(uint32_t e_id) const {
+        return m_versions[slot_of(e_id)];
+    }
+
+    // for bulk passes walking slots rather than entities
+    void mark_slot_changed(uint32_t slot) {
+        m_versions[slot] = m_version;
+    }
+
+protected:
+    uint32_t slot_of(uint32_t e_id) const {
+        return m_sparse.get(e_id);
+    }
+
+    uint32_t next_slot() const {
+        return m_free_slots.empty() ? m_dense_entities.size() : m_free_slots.back();
+    }
+
+    void commit_slot(uint32_t e_id, uint32_t slot) {
+        m_sparse.set(e_id, slot);
+
+        if (slot == m_dense_entities.size()) {
+            m_dense_entities.push_back(e_id);
+            m_versions.push_back(m_version);
+        } else {
+            m_free_slots.pop_back();
+            m_dense_entities[slot] = e_id;
+            m_versions[slot] = m_version;
+        }
+    }
+
+    uint32_t release_slot(uint32_t e_id) {
+        uint32_t slot = slot_of(e_id);
+        m_sparse.reset(e_id);
+
+        if (size() == 1) {
+            m_dense_entities.clear();
+            m_versions.clear();
+            m_free_slots.clear();
+        } else if (slot == m_dense_entities.size() - 1) {
+            m_dense_entities.pop_back();
+            m_versions.pop_back();
+        } else {
+            m_dense_entities[slot] = NO_COMPONENT;
+            m_free_slots.push_back(slot);
+        }
+
+        return slot;
+    }
+
+    void clear_entities() {
+        m_sparse.clear();
+        m_dense_entities.clear();
+        m_versions.clear();
+        m_free_slots.clear();
+    }
+
+    void save_slots(SnapshotWriter &writer) const {
+        writer.write_vector(m_dense_entities);
+        writer.write_vector(m_free_slots);
+    }
+
+    void restore_slots(SnapshotReader &reader) {
+        clear_entities();
+        reader.read_vector(m_dense_entities);
+        reader.read_vector(m_free_slots);
+        m_versions.assign(m_dense_entities.size(), m_version);
+
+        for (uint32_t slot = 0; slot < m_dense_entities.size(); slot++) {
+            if (m_dense_entities[slot] != NO_COMPONENT)
+                m_sparse.set(m_dense_entities[slot], slot);
+        }
+    }
+
+    // owned by the ComponentStore
+    const uint32_t &m_version;
+
+    SparseIndex m_sparse;
+    std::vector<uint32_t> m_dense_entities;
+    std::vector<uint32_t> m_versions;
+    std::vector<uint32_t> m_free_slots;
+};
+
+template <typename Component>
+class ComponentPool : public ComponentPoolBase {
+public:
+    explicit ComponentPool(const uint32_t &version)
+        : ComponentPoolBase(version)
+    {
+    }
+
+    REMOVE_COPY_AND_ASSIGN(ComponentPool);
+
+    ~ComponentPool() {
+        destroy_all();
+    }
+
+    template <typename ...Args>
+    Component &emplace(uint32_t e_id, Args &&...args) {
+        uint32_t slot = slot_of(e_id);
+        if (slot != NO_COMPONENT) {
+            Component &component = at(slot);
+            component = Component(std::forward<Args>(args)...);
+            m_versions[slot] = m_version;
+            return component;
+        }
+
+        slot = next_slot();
+        if (slot / COMPONENT_PAGE_CAPACITY >= m_pages.size())
+            m_pages.push_back(std::make_unique<Page>());
+
+        Component *component = new(&at(slot)) Component(std::forward<Args>(args)...);
+        commit_slot(e_id, slot);
+        return *component;
+    }
+
+    Component &get(uint32_t e_id) {
+        return at(slot_of(e_id));
+    }
+
+    const Component &get(uint32_t e_id) const {
+        return at(slot_of(e_id));
+    }
+
+    void remove(uint32_t e_id) override {
+        if (!contains(e_id))
+            return;
+        at(release_slot(e_id)).~Component();
+    }
+
+    void copy(uint32_t from_e_id, uint32_t to_e_id) override {
+        if constexpr (std::is_copy_constructible_v<Component>)
+            emplace(to_e_id, get(from_e_id));
+        else
+            throw std::runtime_error(fmt::format("Component {} is not copyable", component_id<Component>()));
+    }
+
+    void copy_to_range(uint32_t from_e_id, uint32_t first_e_id, uint32_t count) override {
+        if constexpr (std::is_copy_constructible_v<Component>) {
+            reserve(count);
+            // pages never move, so the source stays valid while we insert
+            const Component &source = get(from_e_id);
+            for (uint32_t i = 0; i < count; i++)
+                emplace(first_e_id + i, source);
+        } else {
+            throw std::runtime_error(fmt::format("Component {} is not copyable", component_id<Component>()));
+        }
+    }
+
+    // makes room for `additional` more components up front
+    void reserve(size_t additional) {
+        size_t slot_count = std::max(m_dense_entities.size(), size() + additional);
+        m_dense_entities.reserve(slot_count);
+        while (m_pages.size() * COMPONENT_PAGE_CAPACITY < slot_count)
+            m_pages.push_back(std::make_unique<Page>());
+    }
+
+    void clear() override {
+        destroy_all();
+        clear_entities();
+    }
+
+    void set_serializer(ComponentSaver<Component> &&saver, ComponentLoader<Component> &&loader) {
+        m_saver = std::move(saver);
+        m_loader = std::move(loader);
+    }
+
+    // A registered serializer wins; otherwise trivially copyable components
+    // are copied a page at a time, holes included. Components that own
+    // outside resources (e.g. Physical) register one even when their bytes
+    // could be copied.
+    void save(SnapshotWriter &writer) const override {
+        save_slots(writer);
+
+        if (m_saver) {
+            for (uint32_t slot = 0; slot < m_dense_entities.size(); slot++) {
+                if (m_dense_entities[slot] != NO_COMPONENT)
+                    m_saver(at(slot), writer);
+            }
+        } else if constexpr (std::is_trivially_copyable_v<Component>) {
+            for (size_t first = 0; first < m_dense_entities.size(); first += COMPONENT_PAGE_CAPACITY) {
+                size_t count = std::min<size_t>(COMPONENT_PAGE_CAPACITY, m_dense_entities.size() - first);
+                writer.write_bytes(m_pages[first / COMPONENT_PAGE_CAPACITY]->data, count * sizeof(Component));
+            }
+        } else if (size() > 0) {
+            throw std::runtime_error(fmt::format("Component {} has no snapshot serializer", component_id<Component>()));
+        }
+    }
+
+    void restore(SnapshotReader &reader) override {
+        clear();
+        restore_slots(reader);
+        while (m_pages.size() * COMPONENT_PAGE_CAPACITY < m_dense_entities.size())
+            m_pages.push_back(std::make_unique<Page>());
+
+        if (m_loader) {
+            uint32_t slot = 0;
+            try {
+                for (; slot < m_dense_entities.size(); slot++) {
+                    if (m_dense_entities[slot] != NO_COMPONENT)
+                        new(&at(slot)) Component(m_loader(reader));
+                }
+            } catch (...) {
+                // only what was constructed so far may be destroyed
+                m_dense_entities.resize(slot);
+                destroy_all();
+                clear_entities();
+                throw;
+            }
+        } else if constexpr (std::is_trivially_copyable_v<Component>) {
+            for (size_t first = 0; first < m_dense_entities.size(); first += COMPONENT_PAGE_CAPACITY) {
+                size_t count = std::min<size_t>(COMPONENT_PAGE_CAPACITY, m_dense_entities.size() - first);
+                reader.read_bytes(m_pages[first / COMPONENT_PAGE_CAPACITY]->data, count * sizeof(Component));
+            }
+        } else if (size() > 0) {
+            clear_entities();
+            throw std::runtime_error(fmt::format("Component {} has no snapshot serializer", component_id<Component>()));
+        }
+    }
+
+private:
+    struct Page {
+        alignas(Component) unsigned char data[COMPONENT_PAGE_CAPACITY * sizeof(Component)];
+    };
+
+    ComponentSaver<Component> m_saver;
+    ComponentLoader<Component> m_loader;
+
+    std::vector<std::unique_ptr<Page>> m_pages;
+
+    Component &at(uint32_t slot) {
+        Page &page = *m_pages[slot / COMPONENT_PAGE_CAPACITY];
+        return reinterpret_cast<Component *>(page.data)[slot % COMPONENT_PAGE_CAPACITY];
+    }
+
+    const Component &at(uint32_t slot) const {
+        const Page &page = *m_pages[slot / COMPONENT_PAGE_CAPACITY];
+        return reinterpret_cast<const Component *>(page.data)[slot % COMPONENT_PAGE_CAPACITY];
+    }
+
+    void destroy_all() {
+        for (uint32_t slot = 0; slot < m_dense_entities.size(); slot++) {
+            if (m_dense_entities[slot] != NO_COMPONENT)
+                at(slot).~Component();
+        }
+    }
+};
+
+// Struct-of-arrays pool for components listed in `Component::soa_fields`
+// (a tuple of member pointers). Each field lives in its own 64 byte aligned
+// array per page, so passes touching one or two fields stream only those
+// and can process several entities per instruction. Access goes through
+// `Component::Ref` / `Component::ConstRef`, aggregates holding a reference
+// to every field in `soa_fields` order. Fields must be trivially copyable.
+template <typename Component>
+class SoaComponentPool : public ComponentPoolBase {
+public:
+    using Ref = typename Component::Ref;
+    using ConstRef = typename Component::ConstRef;
+
+    static constexpr auto FIELDS = Component::soa_fields;
+    static constexpr size_t FIELD_COUNT = std::tuple_size_v<decltype(FIELDS)>;
+
+    template <size_t I>
+    using Field = std::remove_reference_t<decltype(std::declval<Component &>().*std::get<I>(FIELDS))>;
+
+    explicit SoaComponentPool(const uint32_t &version)
+        : ComponentPoolBase(version)
+    {
+    }
+
+    REMOVE_COPY_AND_ASSIGN(SoaComponentPool);
+
+    template <typename ...Args>
+    Ref emplace(uint32_t e_id, Args &&...args) {
+        const Component component(std::forward<Args>(args)...);
+
+        uint32_t slot = slot_of(e_id);
+        if (slot != NO_COMPONENT) {
+            m_versions[slot] = m_version;
+        } else {
+            slot = next_slot();
+            if (slot / COMPONENT_PAGE_CAPACITY >= m_pages.size())
+                m_pages.push_back(std::make_unique<Page>());
+            commit_slot(e_id, slot);
+        }
+
+        store(slot, component, std::make_index_sequence<FIELD_COUNT>());
+        return at(slot);
+    }
+
+    Ref get(uint32_t e_id) {
+        return at(slot_of(e_id));
+    }
+
+    ConstRef get(uint32_t e_id) const {
+        return at(slot_of(e_id));
+    }
+
+    void remove(uint32_t e_id) override {
+        if (!contains(e_id))
+            return;
+        release_slot(e_id);
+    }
+
+    void copy(uint32_t from_e_id, uint32_t to_e_id) override {
+        emplace(to_e_id, load(slot_of(from_e_id), std::make_index_sequence<FIELD_COUNT>()));
+    }
+
+    void copy_to_range(uint32_t from_e_id, uint32_t first_e_id, uint32_t count) override {
+        reserve(count);
+        const Component source = load(slot_of(from_e_id), std::make_index_sequence<FIELD_COUNT>());
+        for (uint32_t i = 0; i < count; i++)
+            emplace(first_e_id + i, source);
+    }
+
+    void reserve(size_t additional) {
+        size_t slot_count = std::max(m_dense_entities.size(), size() + additional);
+        m_dense_entities.reserve(slot_count);
+        while (m_pages.size() * COMPONENT_PAGE_CAPACITY < slot_count)
+            m_pages.push_back(std::make_unique<Page>());
+    }
+
+    void clear() override {
+        m_pages.clear();
+        clear_entities();
+    }
+
+    void save(SnapshotWriter &writer) const override {
+        save_slots(writer);
+        for (size_t first = 0; first < m_dense_entities.size(); first += COMPONENT_PAGE_CAPACITY) {
+            size_t count = std::min<size_t>(COMPONENT_PAGE_CAPACITY, m_dense_entities.size() - first);
+            save_page(writer, *m_pages[first / COMPONENT_PAGE_CAPACITY], count, std::make_index_sequence<FIELD_COUNT>());
+        }
+    }
+
+    void restore(SnapshotReader &reader) override {
+        clear();
+        restore_slots(reader);
+        for (size_t first = 0; first < m_dense_entities.size(); first += COMPONENT_PAGE_CAPACITY) {
+            size_t count = std::min<size_t>(COMPONENT_PAGE_CAPACITY, m_dense_entities.size() - first);
+            m_pages.push_back(std::make_unique<Page>());
+            restore_page(reader, *m_pages.back(), count, std::make_index_sequence<FIELD_COUNT>());
+        }
+    }
+
+    // Bulk access for passes over one field: page `page` holds the slots
+    // [page * COMPONENT_PAGE_CAPACITY, (page + 1) * COMPONENT_PAGE_CAPACITY)
+    // of entities(), and holes hold stale but harmless values.
+    size_t page_count() const {
+        return m_pages.size();
+    }
+
+    template <size_t I>
+    Field<I> *field_data(size_t page) {
+        return std::get<I>(m_pages[page]->fields).data();
+    }
+
+    template <size_t I>
+    const Field<I> *field_data(size_t page) const {
+        return std::get<I>(m_pages[page]->fields).data();
+    }
+
+private:
+    template <size_t ...I>
+    static constexpr bool trivial_fields(std::index_sequence<I...>) {
+        return (std::is_trivially_copyable_v<Field<I>> && ...);
+    }
+
+    static_assert(trivial_fields(std::make_index_sequence<FIELD_COUNT>()),
+                  "SoA component fields must be trivially copyable");
+
+    template <size_t ...I>
+    struct PageFields {
+        std::tuple<std::array<Field<I>, COMPONENT_PAGE_CAPACITY>...> fields;
+    };
+
+    template <size_t ...I>
+    static PageFields<I...> page_fields(std::index_sequence<I...>);
+
+    struct alignas(64) Page : decltype(page_fields(std::make_index_sequence<FIELD_COUNT>())) {};
+
+    std::vector<std::unique_ptr<Page>> m_pages;
+
+    Ref at(uint32_t slot) {
+        return at(slot, std::make_index_sequence<FIELD_COUNT>());
+    }
+
+    ConstRef at(uint32_t slot) const {
+        return at(slot, std::make_index_sequence<FIELD_COUNT>());
+    }
+
+    template <size_t ...I>
+    Ref at(uint32_t slot, std::index_sequence<I...>) {
+        Page &page = *m_pages[slot / COMPONENT_PAGE_CAPACITY];
+        return Ref{ std::get<I>(page.fields)[slot % COMPONENT_PAGE_CAPACITY]... };
+    }
+
+    template <size_t ...I>
+    ConstRef at(uint32_t slot, std::index_sequence<I...>) const {
+        const Page &page = *m_pages[slot / COMPONENT_PAGE_CAPACITY];
+        return ConstRef{ std::get<I>(page.fields)[slot % COMPONENT_PAGE_CAPACITY]... };
+    }
+
+    template <size_t ...I>
+    void store(uint32_t slot, const Component &component, std::index_sequence<I...>) {
+        Page &page = *m_pages[slot / COMPONENT_PAGE_CAPACITY];
+        ((std::get<I>(page.fields)[slot % COMPONENT_PAGE_CAPACITY] = component.*std::get<I>(FIELDS)), ...);
+    }
+
+    template <size_t ...I>
+    static void save_page(SnapshotWriter &writer, const Page &page, size_t count, std::index_sequence<I...>) {
+        (writer.write_bytes(std::get<I>(page.fields).data(), count * sizeof(Field<I>)), ...);
+    }
+
+    template <size_t ...I>
+    static void restore_page(SnapshotReader &reader, Page &page, size_t count, std::index_sequence<I...>) {
+        (reader.read_bytes(std::get<I>(page.fields).data(), count * sizeof(Field<I>)), ...);
+    }
+
+    template <size_t ...I>
+    Component load(uint32_t slot, std::index_sequence<I...>) const {
+        const Page &page = *m_pages[slot / COMPONENT_PAGE_CAPACITY];
+        Component component;
+        ((component.*std::get<I>(FIELDS) = std::get<I>(page.fields)[slot % COMPONENT_PAGE_CAPACITY]), ...);
+        return component;
+    }
+};
+
+// Storage policy of a component type. Components are stored as one struct
+// per slot unless the type opts into struct-of-arrays storage with
+//   template <> struct ComponentStorage<T> : SoaStorage<T> {};
+// Reference is what EntityGroup::get_component hands out.
+template <typename Component>
+struct ComponentStorage {
+    using Pool = ComponentPool<Component>;
+    using Reference = Component &;
+    using ConstReference = const Component &;
+};
+
+template <typename Component>
+struct SoaStorage {
+    using Pool = SoaComponentPool<Component>;
+    using Reference = typename Component::Ref;
+    using ConstReference = typename Component::ConstRef;
+};
+
+template <typename Component>
+using ComponentPoolOf = typename ComponentStorage<Component>::Pool;
+
 class ComponentStore {
 public:
     ComponentStore();
     static ComponentStore &get();
 
     template <typename Component>
-    Component *get_component_zone() {
+    ComponentPoolOf<Component> &get_pool() {
         uint32_t c_id = component_id<Component>();
-        return (Component *)(m_component_store.get() + c_id * COMPONENT_ZONE_SIZE);
+        if (!m_pools[c_id])
+            m_pools[c_id] = std::make_unique<ComponentPoolOf<Component>>(m_version);
+        return static_cast<ComponentPoolOf<Component> &>(*m_pools[c_id]);
     }
 
     template <typename Component>
-    Component *get_component(uint32_t e_id) {
-        uint32_t c_id = component_id<Component>();
-        if (e_id * sizeof(Component) >= COMPONENT_ZONE_SIZE)
-            throw std::runtime_error(fmt::format("Component overflow for entity {}, component {}", e_id, c_id));
-        Component *component_zone = get_component_zone<Component>();
-        return &component_zone[e_id];
+    typename ComponentStorage<Component>::Reference get_component(uint32_t e_id) {
+        auto &pool = get_pool<Component>();
+        if (!pool.contains(e_id))
+            throw std::runtime_error(fmt::format("Component {} missing for entity {}", component_id<Component>(), e_id));
+        pool.mark_changed(e_id);
+        return pool.get(e_id);
+    }
+
+    ComponentPoolBase *get_pool_from_component_id(uint32_t c_id) {
+        if (c_id >= m_pools.size())
+            return nullptr;
+        return m_pools[c_id].get();
     }
 
-    void *get_component_zone_from_component_id(uint32_t c_id) {
-        return (void *)(m_component_store.get() + c_id * COMPONENT_ZONE_SIZE);
+    // needed by components that are not trivially copyable to be snapshot
+    template <typename Component>
+    void register_serializer(ComponentSaver<Component> &&saver, ComponentLoader<Component> &&loader) {
+        get_pool<Component>().set_serializer(std::move(saver), std::move(loader));
     }
 
-    void grow();
-    size_t max_components() const;
+    void clear();
+
+    // every pool that exists, used by EntityGroup::snapshot and restore
+    void save(SnapshotWriter &writer) const;
+    void restore(SnapshotReader &reader);
+
+    // Components are stamped with the current version whenever they are
+    // added or changed. A system that wants to see changes since its last
+    // run keeps the value returned here and compares stamps against it.
+    uint32_t version() const {
+        return m_version;
+    }
+
+    // ends the current version and returns it
+    uint32_t advance_version() {
+        return m_version++;
+    }
 
 private:
-    std::unique_ptr<char[]> m_component_store;
-    uint32_t m_growth{ 1 };
+    std::array<std::unique_ptr<ComponentPoolBase>, MAX_COMPONENT_TYPES> m_pools;
+    uint32_t m_version{ 1 };
 };
 
 template <typename T>
 uint32_t component_id() {
-    static uint32_t c_id = component_type_count++;
-    auto &store = ComponentStore::get();
-    if (c_id >= store.max_components())
-        store.grow();
+    static uint32_t c_id = next_component_id();
     return c_id;
 }
 
+template <typename ...C>
+ComponentMask ComponentMask::from_components() {
+    ComponentMask mask;
+    (mask.set(component_id<C>()), ...);
+    return mask;
+}
+
 }
 
 #endif
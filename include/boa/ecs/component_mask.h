@@ -0,0 +1,85 @@
+#ifndef BOA_ECS_COMPONENT_MASK_H
+#define BOA_ECS_COMPONENT_MASK_H
+
+#include <cstdint>
+#include <cstddef>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace boa::ecs {
+
+// masks are a fixed 128 bits so that one fits in a single SSE register
+// (and two in an AVX2 register) when matching queries
+const uint32_t MAX_COMPONENT_TYPES = 128;
+
+struct alignas(16) ComponentMask {
+    static constexpr uint32_t WORD_COUNT = MAX_COMPONENT_TYPES / 64;
+
+    uint64_t words[WORD_COUNT]{};
+
+    bool test(uint32_t c_id) const {
+        return words[c_id / 64] & (uint64_t(1) << (c_id % 64));
+    }
+
+    void set(uint32_t c_id) {
+        words[c_id / 64] |= uint64_t(1) << (c_id % 64);
+    }
+
+    void reset(uint32_t c_id) {
+        words[c_id / 64] &= ~(uint64_t(1) << (c_id % 64));
+    }
+
+    void clear() {
+        for (auto &word : words)
+            word = 0;
+    }
+
+    bool contains_all(const ComponentMask &required) const {
+#if defined(__SSE4_1__)
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(words));
+        __m128i req = _mm_load_si128(reinterpret_cast<const __m128i *>(required.words));
+        return _mm_testc_si128(mask, req);
+#elif defined(__SSE2__)
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(words));
+        __m128i req = _mm_load_si128(reinterpret_cast<const __m128i *>(required.words));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(mask, req), req)) == 0xFFFF;
+#else
+        for (uint32_t i = 0; i < WORD_COUNT; i++) {
+            if ((words[i] & required.words[i]) != required.words[i])
+                return false;
+        }
+        return true;
+#endif
+    }
+
+    bool intersects(const ComponentMask &other) const {
+        for (uint32_t i = 0; i < WORD_COUNT; i++) {
+            if (words[i] & other.words[i])
+                return true;
+        }
+        return false;
+    }
+
+    bool operator==(const ComponentMask &other) const {
+        for (uint32_t i = 0; i < WORD_COUNT; i++) {
+            if (words[i] != other.words[i])
+                return false;
+        }
+        return true;
+    }
+
+    template <typename ...C>
+    static ComponentMask from_components();
+};
+
+static_assert(sizeof(ComponentMask) == 16, "SIMD matching assumes 128-bit component masks");
+
+// Writes `first_index + i` for every `masks[i]` containing `required` into
+// `out` (which must hold `count` entries) and returns how many were written.
+size_t match_component_masks(const ComponentMask *masks, size_t count, const ComponentMask &required,
+                             uint32_t first_index, uint32_t *out);
+
+}
+
+#endif
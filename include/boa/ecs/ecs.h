@@ -2,6 +2,11 @@
 #define BOA_ECS_H
 
 #include "boa/ecs/component.h"
+#include "boa/ecs/hierarchy.h"
+#include "boa/ecs/snapshot.h"
+#include "boa/ecs/view.h"
 #include "boa/ecs/entity.h"
+#include "boa/ecs/command_buffer.h"
+#include "boa/ecs/scheduler.h"
 
 #endif
\ No newline at end of file
@@ -2,27 +2,45 @@
 #define BOA_ECS_ENTITY_H
 
 #include "boa/utl/iteration.h"
+#include "boa/utl/thread_pool.h"
 #include "boa/ecs/component.h"
+#include "boa/ecs/component_mask.h"
+#include "boa/ecs/handle.h"
+#include "boa/ecs/hierarchy.h"
+#include "boa/ecs/view.h"
 #include <cstdint>
 #include <vector>
-#include <bitset>
+#include <memory>
 #include <algorithm>
 #include <optional>
+#include <utility>
 
 namespace boa::ecs {
 
-struct EntityMeta {
-    EntityMeta(uint32_t id_)
-        : id(id_),
-          component_mask(COMPONENTS_START_COUNT)
-    {
-    }
+const size_t QUERY_BLOCK_SIZE = 256;
+// parallel queries aim for chunks whose components fit in L1
+const size_t PARALLEL_CHUNK_BYTES = 32 * KiB;
+const size_t MIN_PARALLEL_CHUNK_SIZE = 64;
+const size_t MAX_PARALLEL_CHUNK_SIZE = 4096;
+
+// Consecutive fresh entities, as returned by EntityGroup::instantiate. Fresh
+// slots start at generation 0, so their handles are consecutive integers.
+struct EntityRange {
+    struct Iterator {
+        uint32_t e_id;
 
-    void grow_if_needed(uint32_t id);
+        uint32_t operator*() const { return e_id; }
+        Iterator &operator++() { e_id++; return *this; }
+        bool operator!=(const Iterator &other) const { return e_id != other.e_id; }
+    };
 
-    std::vector<bool> component_mask;
-    uint32_t id;
-    bool active{ true };
+    uint32_t first{ 0 };
+    uint32_t count{ 0 };
+
+    Iterator begin() const { return { first }; }
+    Iterator end() const { return { first + count }; }
+    uint32_t operator[](uint32_t i) const { return first + i; }
+    uint32_t size() const { return count; }
 };
 
 struct EntityGroup {
@@ -30,140 +48,246 @@ struct EntityGroup {
     static EntityGroup &get();
 
     uint32_t new_entity();
+    // also deletes every descendant of `e_id`
     void delete_entity(uint32_t e_id);
 
-    void clear_entities();
-
-    template <typename ...C>
-    uint32_t copy_entity(uint32_t copy_e_id) {
-        const EntityMeta &other = entities[copy_e_id];
-        uint32_t c_ids[] = { component_id<C>()... };
-        uint32_t c_size[] = { sizeof(C)... };
+    bool is_valid(uint32_t e_id) const {
+        uint32_t index = entity_index(e_id);
+        return index < m_entities.size() && m_entities[index] == e_id;
+    }
 
-        uint32_t new_e_id = entities.size();
+    void clear_entities();
 
-        if (free_entities.size() > 0) {
-            new_e_id = free_entities.back();
-            free_entities.pop_back();
-        }
+    // Binary copy of every entity, component and the hierarchy, cheap enough
+    // to take every frame. `snapshot` reuses the buffer it is given. Restoring
+    // replaces the whole group; a snapshot that does not match the group
+    // throws and leaves it empty.
+    void snapshot(Snapshot &snapshot) const;
+    void restore(const Snapshot &snapshot);
 
-        for (size_t i = 0; i < sizeof...(C); i++) {
-            if (!entities[copy_e_id].component_mask[c_ids[i]])
-                continue;
-            auto &component_store = ComponentStore::get();
-            void *component_zone = component_store.get_component_zone_from_component_id(c_ids[i]);
-            if (new_e_id * c_size[i] >= COMPONENT_ZONE_SIZE)
-                throw std::runtime_error(fmt::format("Component overflow for entity {}", new_e_id));
-            memcpy((char *)component_zone + c_size[i] * new_e_id, (char *)component_zone + c_size[i] * copy_e_id, c_size[i]);
-        }
+    // Copies every component enabled on the source entity. A copy gets the
+    // same parent as its source but none of its children.
+    uint32_t copy_entity(uint32_t copy_e_id);
 
-        EntityMeta new_entity_meta(new_e_id);
-        new_entity_meta.component_mask = other.component_mask;
-        entities.push_back(std::move(new_entity_meta));
+    // Creates `count` copies of `prototype` in one go: slots, masks, views
+    // and every component pool grow once and are filled in bulk. Copies
+    // always take fresh slots (free ones are left to new_entity) so the
+    // result is a contiguous range. `initializer(e_id, i)` then runs for the
+    // i-th copy and may change it freely. Only the prototype's components
+    // in `components` are copied, or in C... for the template (all of them
+    // if none are given).
+    EntityRange instantiate(uint32_t prototype, uint32_t count);
+    EntityRange instantiate(uint32_t prototype, uint32_t count, const ComponentMask &components);
 
-        return new_e_id;
+    template <typename ...C, typename Initializer>
+    EntityRange instantiate(uint32_t prototype, uint32_t count, Initializer initializer) {
+        EntityRange range;
+        if constexpr (sizeof...(C) == 0)
+            range = instantiate(prototype, count);
+        else
+            range = instantiate(prototype, count, ComponentMask::from_components<C...>());
+        for (uint32_t i = 0; i < range.size(); i++)
+            initializer(range[i], i);
+        return range;
     }
 
     template <typename C>
     void enable(uint32_t e_id) {
-        if (e_id >= entities.size() || !entities[e_id].active)
+        if (!is_valid(e_id))
             return;
+
         uint32_t c_id = component_id<C>();
-        entities[e_id].grow_if_needed(c_id);
-        entities[e_id].component_mask[c_id] = true;
+        if (m_component_masks[entity_index(e_id)].test(c_id))
+            return;
+
+        ComponentStore::get().get_pool<C>().emplace(e_id);
+        set_component_bit(e_id, c_id);
     }
 
     template <typename C, typename ...Args>
     void make(uint32_t e_id, Args &&...args) {
-        if (e_id >= entities.size() || !entities[e_id].active)
+        if (!is_valid(e_id))
             return;
 
-        uint32_t c_id = component_id<C>();
         if (!has_component<C>(e_id))
             throw std::runtime_error("Attempted to make disabled component for entity");
 
-        entities[e_id].grow_if_needed(c_id);
-        auto &component_store = ComponentStore::get();
-        C *component = component_store.get_component<C>(e_id);
-        new(component) C(std::forward<Args>(args)...); 
+        ComponentStore::get().get_pool<C>().emplace(e_id, std::forward<Args>(args)...);
     }
 
     template <typename C, typename ...Args>
     void enable_and_make(uint32_t e_id, Args &&...args) {
-        if (e_id >= entities.size() || !entities[e_id].active)
+        if (!is_valid(e_id))
             return;
 
+        ComponentStore::get().get_pool<C>().emplace(e_id, std::forward<Args>(args)...);
         uint32_t c_id = component_id<C>();
-        entities[e_id].grow_if_needed(c_id);
-        entities[e_id].component_mask[c_id] = true;
-        auto &component_store = ComponentStore::get();
-        C *component = component_store.get_component<C>(e_id);
-        new(component) C(std::forward<Args>(args)...); 
+        if (!m_component_masks[entity_index(e_id)].test(c_id))
+            set_component_bit(e_id, c_id);
     }
 
     template <typename C>
     void disable(uint32_t e_id) {
-        if (e_id >= entities.size() || !entities[e_id].active)
+        if (!is_valid(e_id))
             return;
 
         uint32_t c_id = component_id<C>();
-        entities[e_id].grow_if_needed(c_id);
-        entities[e_id].component_mask[c_id] = false;
+        if (!m_component_masks[entity_index(e_id)].test(c_id))
+            return;
+
+        ComponentStore::get().get_pool<C>().remove(e_id);
+        reset_component_bit(e_id, c_id);
     }
 
     template <typename C>
     bool has_component(uint32_t e_id) const {
-        if (e_id >= entities.size() || !entities[e_id].active)
+        if (!is_valid(e_id))
             return false;
+        return m_component_masks[entity_index(e_id)].test(component_id<C>());
+    }
 
-        uint32_t c_id = component_id<C>();
-        if (c_id >= entities[e_id].component_mask.size())
-            return false;
-        return entities[e_id].component_mask[c_id];
+    // Mutable access marks the component as changed in the current store
+    // version, so read through a const EntityGroup (e.g. std::as_const)
+    // where nothing is written.
+    // SoA components (see ComponentStorage) come back as a proxy of
+    // references, take those by value: `auto transform = get_component<...>`.
+    template <typename C>
+    typename ComponentStorage<C>::Reference get_component(uint32_t e_id) {
+        auto &pool = checked_pool<C>(e_id);
+        pool.mark_changed(e_id);
+        return pool.get(e_id);
     }
 
     template <typename C>
-    C &get_component(uint32_t e_id) {
-        if (e_id >= entities.size() || !entities[e_id].active)
-            throw std::runtime_error("Attempted to get component for non-existent entity");
-        if (!has_component<C>(e_id))
-            throw std::runtime_error("Attempted to get component that does not exist for entity");
-        auto &component_store = ComponentStore::get();
-        C *component_zone = component_store.get_component_zone<C>();
-        return component_zone[e_id];
+    typename ComponentStorage<C>::ConstReference get_component(uint32_t e_id) const {
+        return std::as_const(checked_pool<C>(e_id)).get(e_id);
     }
 
-    template <typename ...C, typename Callback>
-    void for_each_entity_with_component(Callback callback) const {
-        uint32_t c_ids[] = { component_id<C>()... };
-        for (auto &entity : entities) {
-            if (!entity.active)
+    template <typename C>
+    void mark_changed(uint32_t e_id) {
+        checked_pool<C>(e_id).mark_changed(e_id);
+    }
+
+    // Visits entities whose `Changed` component was added or changed after
+    // `since_version` (see ComponentStore::version) and that also have
+    // every component in `C...`. Costs one compare per `Changed` component.
+    template <typename Changed, typename ...C, typename Callback>
+    void for_each_changed_entity(uint32_t since_version, Callback callback) const {
+        const ComponentMask required = ComponentMask::from_components<Changed, C...>();
+        const auto &pool = ComponentStore::get().get_pool<Changed>();
+        const std::vector<uint32_t> &pool_entities = pool.entities();
+        const std::vector<uint32_t> &versions = pool.versions();
+
+        for (size_t slot = 0; slot < pool_entities.size(); slot++) {
+            uint32_t e_id = pool_entities[slot];
+            if (e_id == ComponentPoolBase::NO_COMPONENT || versions[slot] <= since_version)
                 continue;
-            if (std::all_of(std::begin(c_ids), std::end(c_ids), [&](uint32_t c_id) { return entity.component_mask[c_id]; })) {
-                if (callback(entity.id) == Iteration::Break)
-                    break;
-            }
+            if (!m_component_masks[entity_index(e_id)].contains_all(required))
+                continue;
+            if (callback(e_id) == Iteration::Break)
+                break;
         }
     }
 
+    // Views are created on first use and then maintained incrementally
+    // for the lifetime of the group. Creating one is not thread-safe.
+    template <typename ...C>
+    const View &view() const {
+        static_assert(sizeof...(C) > 0, "A view needs at least one component");
+        return get_view(ComponentMask::from_components<C...>());
+    }
+
+    // The callback may remove components from (or delete) the current entity.
+    template <typename ...C, typename Callback>
+    void for_each_entity_with_component(Callback callback) const {
+        view<C...>().each(callback);
+    }
+
+    // Runs `callback(e_id)` for every matching entity on the ThreadPool and
+    // returns once all of them were visited, in no particular order. The
+    // callback may read and write the components of the entity it is given
+    // and read (but not write) anything else. It must not enable, disable,
+    // create or delete anything, since that changes masks, pools and views
+    // shared by every thread; collect such changes and apply them after.
+    // The view is created on first use, which is not thread-safe either:
+    // systems that may run concurrently need theirs made beforehand.
+    template <typename ...C, typename Callback>
+    void parallel_for_each_entity_with_component(Callback callback) {
+        // pools are created lazily, make sure no worker ends up creating one
+        auto &component_store = ComponentStore::get();
+        (component_store.get_pool<C>(), ...);
+
+        const std::vector<uint32_t> &matching = view<C...>().entities();
+        const size_t chunk_size = std::clamp(PARALLEL_CHUNK_BYTES / (sizeof(C) + ...),
+                                             MIN_PARALLEL_CHUNK_SIZE, MAX_PARALLEL_CHUNK_SIZE);
+
+        ThreadPool::get().parallel_for(matching.size(), chunk_size, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                callback(matching[i]);
+        });
+    }
+
+    // Attaches `e_id` below `parent_e_id`, detaching it from any previous
+    // parent first. Every component of `e_id` is marked changed so passes
+    // that derive state from the hierarchy (e.g. world transforms) pick it up.
+    void set_parent(uint32_t e_id, uint32_t parent_e_id);
+    void remove_parent(uint32_t e_id);
+
+    // Every parent-child edge in breadth-first order: all edges of depth one
+    // (children of roots), then depth two and so on, so visiting the list
+    // front to back always reaches a parent before its children. Rebuilt on
+    // first use after the hierarchy changed.
+    const std::vector<HierarchyLink> &hierarchy_order() const;
+
     template <typename ...C>
     std::optional<uint32_t> find_first_entity_with_component() const {
-        uint32_t c_ids[] = { component_id<C>()... };
-        for (auto &entity : entities) {
-            if (!entity.active)
-                continue;
-            if (std::all_of(std::begin(c_ids), std::end(c_ids), [&](uint32_t c_id) { return entity.component_mask[c_id]; }))
-                return entity.id;
-        }
-        return std::nullopt;
+        const View &matching = view<C...>();
+        if (matching.empty())
+            return std::nullopt;
+        return matching.entities().front();
     }
 
     uint32_t size() const {
-        return entities.size() - free_entities.size();
+        return m_entities.size() - m_free_count;
     }
 
-    std::vector<EntityMeta> entities;
-    std::vector<uint32_t> free_entities;
+private:
+    // Indexed by entity slot. A live slot holds the entity's handle; a free
+    // slot holds the next free slot and the generation its next owner gets,
+    // and a retired slot the end of the free list. Neither ever equals a
+    // handle for that slot, so validity is one compare.
+    std::vector<uint32_t> m_entities;
+    // kept apart from `m_entities` so queries stream through masks only
+    std::vector<ComponentMask> m_component_masks;
+    uint32_t m_free_head{ NO_FREE_ENTITY };
+    // free and retired slots, neither holds an entity
+    uint32_t m_free_count{ 0 };
+
+    static constexpr uint32_t NO_FREE_ENTITY = ENTITY_INDEX_MASK;
+    static constexpr uint32_t SNAPSHOT_MAGIC = 0x50414e53;
+
+    template <typename C>
+    ComponentPoolOf<C> &checked_pool(uint32_t e_id) const {
+        if (!is_valid(e_id))
+            throw std::runtime_error("Attempted to get component for non-existent entity");
+        if (!has_component<C>(e_id))
+            throw std::runtime_error("Attempted to get component that does not exist for entity");
+        return ComponentStore::get().get_pool<C>();
+    }
+
+    mutable std::vector<HierarchyLink> m_hierarchy_order;
+    mutable bool m_hierarchy_dirty{ false };
+
+    void mark_all_changed(uint32_t e_id);
+
+    const View &get_view(const ComponentMask &required) const;
+    void fill_view(View &view) const;
+    void update_views(uint32_t e_id, const ComponentMask &old_mask);
+    void set_component_bit(uint32_t e_id, uint32_t c_id);
+    void reset_component_bit(uint32_t e_id, uint32_t c_id);
+
+    // few distinct queries exist, so a linear search beats hashing masks
+    mutable std::vector<std::unique_ptr<View>> m_views;
 };
 
 }
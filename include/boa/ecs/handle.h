@@ -0,0 +1,35 @@
+#ifndef BOA_ECS_HANDLE_H
+#define BOA_ECS_HANDLE_H
+
+#include <cstdint>
+
+namespace boa::ecs {
+
+// Entity ids are 32-bit handles: the low bits pick a slot and the high
+// bits hold a generation that is bumped whenever the slot is freed, so a
+// stale id never aliases the entity that later reuses its slot. A slot
+// whose generation would wrap is retired instead of reused.
+const uint32_t ENTITY_INDEX_BITS = 22;
+const uint32_t ENTITY_GENERATION_BITS = 32 - ENTITY_INDEX_BITS;
+const uint32_t ENTITY_INDEX_MASK = (uint32_t(1) << ENTITY_INDEX_BITS) - 1;
+const uint32_t ENTITY_GENERATION_MASK = (uint32_t(1) << ENTITY_GENERATION_BITS) - 1;
+
+// the all-ones index ends the free list and is never handed out, which also
+// keeps UINT32_MAX free to mean "no entity"
+const uint32_t MAX_ENTITIES = ENTITY_INDEX_MASK;
+
+inline uint32_t entity_index(uint32_t e_id) {
+    return e_id & ENTITY_INDEX_MASK;
+}
+
+inline uint32_t entity_generation(uint32_t e_id) {
+    return e_id >> ENTITY_INDEX_BITS;
+}
+
+inline uint32_t make_entity_handle(uint32_t index, uint32_t generation) {
+    return ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+}
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef BOA_ECS_HIERARCHY_H
+#define BOA_ECS_HIERARCHY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace boa::ecs {
+
+// Managed through EntityGroup::set_parent and EntityGroup::remove_parent,
+// never enable or disable these directly.
+struct Parent {
+    Parent()
+        : e_id(0)
+    {
+    }
+
+    Parent(uint32_t parent_e_id)
+        : e_id(parent_e_id)
+    {
+    }
+
+    uint32_t e_id;
+};
+
+struct Children {
+    std::vector<uint32_t> e_ids;
+};
+
+// one parent-child edge of EntityGroup::hierarchy_order
+struct HierarchyLink {
+    uint32_t e_id;
+    uint32_t parent_e_id;
+};
+
+}
+
+#endif
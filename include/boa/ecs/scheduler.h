@@ -0,0 +1,102 @@
+#ifndef BOA_ECS_SCHEDULER_H
+#define BOA_ECS_SCHEDULER_H
+
+#include "boa/utl/macros.h"
+#include "boa/utl/thread_pool.h"
+#include "boa/ecs/component.h"
+#include "boa/ecs/component_mask.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <optional>
+
+namespace boa::ecs {
+
+// Components a system touches. Two systems conflict when one writes a
+// component the other reads or writes; exclusive systems conflict with
+// everything and always run on the thread calling SystemScheduler::run
+// (needed for anything touching the window, ImGui or Vulkan).
+// EntityGroup views are created lazily and not thread-safely, so every view
+// a non-exclusive system iterates must exist before the scheduler first runs.
+struct SystemAccess {
+    template <typename ...C>
+    SystemAccess &read() {
+        (reads.set(component_id<C>()), ...);
+        return *this;
+    }
+
+    template <typename ...C>
+    SystemAccess &write() {
+        (writes.set(component_id<C>()), ...);
+        return *this;
+    }
+
+    SystemAccess &exclusive() {
+        is_exclusive = true;
+        return *this;
+    }
+
+    bool conflicts_with(const SystemAccess &other) const;
+
+    ComponentMask reads;
+    ComponentMask writes;
+    bool is_exclusive{ false };
+};
+
+struct SystemTiming {
+    std::string name;
+    float milliseconds;
+};
+
+// Runs registered systems once per frame. Conflicting systems keep their
+// registration order, everything else runs concurrently on the ThreadPool.
+class SystemScheduler {
+public:
+    using SystemFunction = std::function<void(float)>;
+
+    SystemScheduler() {}
+    REMOVE_COPY_AND_ASSIGN(SystemScheduler);
+
+    void add_system(std::string &&name, const SystemAccess &access, SystemFunction &&function);
+
+    // blocks until every system ran, rethrows the first exception one threw
+    void run(float time_change);
+
+    // timings of the last run, in registration order
+    const std::vector<SystemTiming> &get_timings() const {
+        return m_timings;
+    }
+
+private:
+    struct System {
+        std::string name;
+        SystemAccess access;
+        SystemFunction function;
+        std::vector<uint32_t> successors;
+        uint32_t predecessor_count{ 0 };
+    };
+
+    std::vector<System> m_systems;
+    std::vector<SystemTiming> m_timings;
+    bool m_graph_dirty{ false };
+
+    // per run state
+    std::unique_ptr<std::atomic<uint32_t>[]> m_remaining;
+    std::atomic<uint32_t> m_finished{ 0 };
+    std::vector<uint32_t> m_exclusive_ready;
+    std::mutex m_exclusive_mutex;
+    std::exception_ptr m_exception;
+    std::mutex m_exception_mutex;
+
+    void build_graph();
+    void schedule(uint32_t system_id, ThreadPool::TaskGroup &group, float time_change);
+    void execute(uint32_t system_id, ThreadPool::TaskGroup &group, float time_change);
+};
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef BOA_ECS_SNAPSHOT_H
+#define BOA_ECS_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+namespace boa::ecs {
+
+// Binary copy of an EntityGroup and its components, see
+// EntityGroup::snapshot. Component ids are handed out at runtime, so a
+// snapshot can only be restored by the process that took it.
+struct Snapshot {
+    std::vector<uint8_t> data;
+
+    bool empty() const {
+        return data.empty();
+    }
+
+    size_t size() const {
+        return data.size();
+    }
+};
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::vector<uint8_t> &data)
+        : m_data(data)
+    {
+    }
+
+    void write_bytes(const void *bytes, size_t size) {
+        const uint8_t *begin = static_cast<const uint8_t *>(bytes);
+        m_data.insert(m_data.end(), begin, begin + size);
+    }
+
+    template <typename T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written directly");
+        write_bytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void write_vector(const std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written directly");
+        write<uint64_t>(values.size());
+        write_bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void write_string(const std::string &value) {
+        write<uint64_t>(value.size());
+        write_bytes(value.data(), value.size());
+    }
+
+private:
+    std::vector<uint8_t> &m_data;
+};
+
+// Reads back what a SnapshotWriter wrote, in the same order. Running past
+// the end throws instead of reading garbage.
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const std::vector<uint8_t> &data)
+        : m_position(data.data()),
+          m_end(data.data() + data.size())
+    {
+    }
+
+    void read_bytes(void *bytes, size_t size) {
+        if (size > static_cast<size_t>(m_end - m_position))
+            throw std::runtime_error("Attempted to read past the end of a snapshot");
+        if (size > 0)
+            std::memcpy(bytes, m_position, size);
+        m_position += size;
+    }
+
+    template <typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read directly");
+        T value;
+        read_bytes(&value, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void read_vector(std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read directly");
+        uint64_t count = read<uint64_t>();
+        if (count > static_cast<size_t>(m_end - m_position) / sizeof(T))
+            throw std::runtime_error("Attempted to read past the end of a snapshot");
+        values.resize(count);
+        read_bytes(values.data(), count * sizeof(T));
+    }
+
+    std::string read_string() {
+        uint64_t size = read<uint64_t>();
+        if (size > static_cast<size_t>(m_end - m_position))
+            throw std::runtime_error("Attempted to read past the end of a snapshot");
+        std::string value(reinterpret_cast<const char *>(m_position), size);
+        m_position += size;
+        return value;
+    }
+
+    bool at_end() const {
+        return m_position == m_end;
+    }
+
+private:
+    const uint8_t *m_position;
+    const uint8_t *m_end;
+};
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef BOA_ECS_VIEW_H
+#define BOA_ECS_VIEW_H
+
+#include "boa/utl/iteration.h"
+#include "boa/utl/macros.h"
+#include "boa/ecs/component.h"
+#include "boa/ecs/component_mask.h"
+#include <cstdint>
+#include <vector>
+
+namespace boa::ecs {
+
+// Packed list of the entities whose mask contains `required`. EntityGroup
+// keeps its views up to date on every mask change, so iterating a view
+// costs O(matches) rather than a scan over every entity.
+class View {
+public:
+    View(const ComponentMask &required)
+        : m_required(required)
+    {
+    }
+
+    REMOVE_COPY_AND_ASSIGN(View);
+
+    const ComponentMask &required() const {
+        return m_required;
+    }
+
+    bool contains(uint32_t e_id) const {
+        uint32_t position = m_positions.get(e_id);
+        return position != SparseIndex::NONE && m_entities[position] == e_id;
+    }
+
+    size_t size() const {
+        return m_entities.size();
+    }
+
+    bool empty() const {
+        return m_entities.empty();
+    }
+
+    const std::vector<uint32_t> &entities() const {
+        return m_entities;
+    }
+
+    // The callback may remove components from (or delete) the current
+    // entity, but not change which other entities match.
+    template <typename Callback>
+    void each(Callback callback) const {
+        for (size_t i = 0; i < m_entities.size();) {
+            uint32_t e_id = m_entities[i];
+            if (callback(e_id) == Iteration::Break)
+                return;
+            // a removed entity is replaced by the last one, which still needs a visit
+            if (i < m_entities.size() && m_entities[i] == e_id)
+                i++;
+        }
+    }
+
+    void update(uint32_t e_id, const ComponentMask &old_mask, const ComponentMask &new_mask) {
+        bool matched = old_mask.contains_all(m_required);
+        bool matches = new_mask.contains_all(m_required);
+        if (matched == matches)
+            return;
+
+        if (matches)
+            insert(e_id);
+        else
+            remove(e_id);
+    }
+
+    void reserve(size_t additional) {
+        m_entities.reserve(m_entities.size() + additional);
+    }
+
+    void insert(uint32_t e_id) {
+        m_positions.set(e_id, m_entities.size());
+        m_entities.push_back(e_id);
+    }
+
+    void remove(uint32_t e_id) {
+        uint32_t position = m_positions.get(e_id);
+        if (position == SparseIndex::NONE)
+            return;
+
+        uint32_t last_e_id = m_entities.back();
+        m_entities[position] = last_e_id;
+        m_positions.set(last_e_id, position);
+        m_entities.pop_back();
+        m_positions.reset(e_id);
+    }
+
+    void clear() {
+        m_entities.clear();
+        m_positions.clear();
+    }
+
+private:
+    ComponentMask m_required;
+    std::vector<uint32_t> m_entities;
+    SparseIndex m_positions;
+};
+
+}
+
+#endif
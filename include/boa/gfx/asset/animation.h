@@ -15,7 +15,8 @@ class glTFModel;
 class AnimationController {
     REMOVE_COPY_AND_ASSIGN(AnimationController);
 public:
-    AnimationController() {}
+    // registers the Animated snapshot serializer, see ecs::EntityGroup::snapshot
+    AnimationController();
 
     void load_animations(uint32_t e_id, const boa::gfx::glTFModel &model);
     void play_animation(uint32_t e_id, uint32_t animation_id, bool loop = false, float speed = 1.0f);
@@ -70,7 +71,7 @@ struct Animated {
 
     void reset();
     void update(float time_change);
-    glm::mat4 transform_for_node(size_t node_id);
+    glm::mat4 transform_for_node(size_t node_id) const;
 };
 
 }
@@ -20,6 +20,8 @@ struct GPUMaterial {
     vk::DescriptorSet texture_set{ VK_NULL_HANDLE };
     vk::Pipeline pipeline{ VK_NULL_HANDLE };
     vk::PipelineLayout pipeline_layout{ VK_NULL_HANDLE };
+    // small dense id of the pipeline, for render sort keys
+    uint32_t pipeline_id{ 0 };
     glm::vec4 base_color;
     uint32_t descriptor_number;
 
@@ -52,10 +54,18 @@ struct GPUSkybox {
 };
 
 struct GPUPrimitive {
-    Sphere bounding_sphere;
-    uint32_t index_count;
+    struct Lod {
+        // into the asset manager's index arena
+        uint32_t first_index;
+        uint32_t index_count;
+    };
+
+    // relative to the node the primitive is in
+    Box bounding_box;
     uint32_t material;
-    VmaBuffer index_buffer;
+    // lods[0] is the full mesh, the rest coarser and coarser
+    std::array<Lod, glTFModel::MAX_LODS> lods;
+    uint32_t lod_count;
 };
 
 struct GPUNode {
@@ -72,10 +82,26 @@ struct GPUModel {
     std::vector<GPUPrimitive> primitives;
     std::vector<uint32_t> root_nodes;
 
+    // The node tree flattened with parents before their children, so
+    // transforms can be propagated in a single pass.
+    struct FlatNode {
+        uint32_t node;
+        // into flat_nodes, -1 for roots
+        int32_t parent;
+        // node transforms multiplied from the root down, without animation
+        glm::mat4 model_transform;
+    };
+
+    std::vector<FlatNode> flat_nodes;
+    // flat_nodes that have primitives
+    std::vector<uint32_t> drawable_nodes;
+
     Box bounding_box;
 
-    VmaBuffer bounding_box_vertex_buffer;
-    VmaBuffer vertex_buffer;
+    // into the asset manager's vertex and bounding box arenas
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t bounding_box_first_vertex;
 
     LightingInteractivity lighting;
 
@@ -88,11 +114,12 @@ private:
     vk::Sampler create_sampler(AssetManager &asset_manager, Renderer &renderer, const glTFModel::Sampler &sampler);
     void add_from_node(AssetManager &asset_manager, Renderer &renderer, const glTFModel &model, const glTFModel::Node &node);
     void calculate_model_bounding_box(const glTFModel &model, const glTFModel::Node &node, glm::mat4 transform_matrix);
+    void flatten_nodes();
 
-    void upload_primitive_indices(AssetManager &asset_manager, Renderer &renderer, GPUPrimitive &vk_primitive,
+    void upload_primitive_indices(AssetManager &asset_manager, GPUPrimitive &vk_primitive,
         const glTFModel::Primitive &primitive);
-    void upload_model_vertices(AssetManager &asset_manager, Renderer &renderer, const glTFModel &model);
-    void upload_bounding_box_vertices(AssetManager &asset_manager, Renderer &renderer);
+    void upload_model_vertices(AssetManager &asset_manager, const glTFModel &model);
+    void upload_bounding_box_vertices(AssetManager &asset_manager);
 };
 
 }
@@ -5,6 +5,7 @@
 #include "boa/utl/macros.h"
 #include "boa/utl/deletion_queue.h"
 #include "boa/gfx/asset/asset.h"
+#include "boa/gfx/asset/mesh_arena.h"
 #include "boa/gfx/lighting_type.h"
 #include <string>
 #include <array>
@@ -29,6 +30,22 @@ struct Renderable {
     uint32_t model_id;
 };
 
+// world space bounds of a Renderable, refreshed by the renderer only when
+// the Renderable or its Transformable changed
+struct RenderBounds {
+    RenderBounds() {}
+    RenderBounds(const Box &box, uint32_t proxy)
+        : bounding_box(box),
+          bounding_sphere(Sphere::bounding_sphere_from_bounding_box(box)),
+          scene_proxy(proxy)
+    {
+    }
+    Box bounding_box;
+    Sphere bounding_sphere;
+    // the entity's leaf in the SceneIndex
+    uint32_t scene_proxy{ UINT32_MAX };
+};
+
 class AssetManager {
     REMOVE_COPY_AND_ASSIGN(AssetManager);
 public:
@@ -55,6 +72,11 @@ public:
     GPUMaterial &get_material(size_t index) { return m_materials.at(index); }
     const GPUModel &get_model(uint32_t id) const { return m_models[id]; }
 
+    // shared by every model, bound once for all model draws
+    vk::Buffer get_vertex_buffer() const { return m_vertex_arena.get_buffer(); }
+    vk::Buffer get_index_buffer() const { return m_index_arena.get_buffer(); }
+    vk::Buffer get_bounding_box_vertex_buffer() const { return m_bounding_box_arena.get_buffer(); }
+
     //const ModelMetaData &get_model_meta_data(uint32_t id) const { return m_models_meta_data[id]; }
 
     /*template <typename C>
@@ -72,13 +94,23 @@ public:
     void reset();
 
 private:
+    // arenas start this big (in elements) and double when outgrown
+    constexpr static uint32_t INITIAL_VERTEX_CAPACITY = 1 << 18;
+    constexpr static uint32_t INITIAL_INDEX_CAPACITY = 1 << 20;
+    constexpr static uint32_t INITIAL_BOUNDING_BOX_VERTEX_CAPACITY = 24 * 256;
+
     Renderer &m_renderer;
     DeletionQueue m_deletion_queue;
 
     std::unordered_map<std::string, uint32_t> m_model_path_to_model_index;
 
     std::vector<GPUModel> m_models;
+    MeshArena m_vertex_arena;
+    MeshArena m_index_arena;
+    MeshArena m_bounding_box_arena;
     std::vector<GPUMaterial> m_materials;
+    // distinct pipelines of all materials, index is GPUMaterial::pipeline_id
+    std::vector<vk::Pipeline> m_pipelines;
     std::optional<uint32_t> m_active_skybox;
 
     friend class GPUModel;
@@ -50,11 +50,22 @@ public:
         void *data;
     };
 
+    // levels of detail generated for every primitive, including the full mesh
+    static constexpr uint32_t MAX_LODS = 4;
+
     struct Primitive {
+        // a range of `indices`, each level about half as many triangles as
+        // the one before
+        struct Lod {
+            uint32_t first_index;
+            uint32_t index_count;
+        };
+
         Box bounding_box;
         Sphere bounding_sphere;
         std::optional<size_t> material;
         std::vector<uint32_t> indices;
+        std::vector<Lod> lods;
         bool has_vertex_coloring{ false };
     };
 
@@ -242,6 +253,7 @@ private:
     std::string m_path;
 
     void debug_print_node(const Node &node, uint32_t indent) const;
+    void generate_lods(Primitive &primitive) const;
 
     std::vector<Vertex> m_vertices;
 
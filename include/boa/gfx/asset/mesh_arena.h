@@ -0,0 +1,47 @@
+#ifndef BOA_GFX_ASSET_MESH_ARENA_H
+#define BOA_GFX_ASSET_MESH_ARENA_H
+
+#include "boa/utl/macros.h"
+#include "boa/utl/free_list_allocator.h"
+#include "boa/gfx/vk/types.h"
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace boa::gfx {
+
+class Renderer;
+
+// One device local buffer that the vertices or indices of every model are
+// sub-allocated from, so all draws share a single binding and address
+// their range with firstIndex/vertexOffset. Ranges are in elements.
+class MeshArena {
+    REMOVE_COPY_AND_ASSIGN(MeshArena);
+public:
+    MeshArena(Renderer &renderer, vk::BufferUsageFlags usage, uint32_t element_size, uint32_t initial_capacity);
+
+    // copies `count` elements into a free range and returns its first element
+    uint32_t upload(const void *elements, uint32_t count);
+    void free(uint32_t first, uint32_t count);
+    // frees every range, the buffer is kept for the next models
+    void clear();
+
+    vk::Buffer get_buffer() const {
+        return m_buffer.buffer;
+    }
+
+private:
+    Renderer &m_renderer;
+    vk::BufferUsageFlags m_usage;
+    uint32_t m_element_size;
+    uint32_t m_initial_capacity;
+
+    // created on first upload, the allocator does not exist before then
+    VmaBuffer m_buffer{};
+    FreeListAllocator m_ranges;
+
+    void grow(uint32_t min_capacity);
+};
+
+}
+
+#endif
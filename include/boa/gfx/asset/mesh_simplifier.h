@@ -0,0 +1,26 @@
+#ifndef BOA_GFX_ASSET_MESH_SIMPLIFIER_H
+#define BOA_GFX_ASSET_MESH_SIMPLIFIER_H
+
+#include "boa/gfx/linear.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace boa::gfx {
+
+// Simplifies the triangle list `indices` into `vertices` by collapsing
+// edges cheapest first, as measured by quadric error (Garland and Heckbert
+// 1997). A vertex is always moved onto a neighbour, so the result indexes
+// the same vertices and only needs an index range of its own. Vertices on
+// borders and on attribute seams, shared by several vertices with the same
+// position, never move.
+//
+// Stops once at most `target_index_count` indices are left or when the
+// cheapest collapse would move the surface further than `max_error`, as a
+// distance in model units.
+std::vector<uint32_t> simplify_mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+    size_t target_index_count, float max_error);
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef BOA_GFX_CULLING_H
+#define BOA_GFX_CULLING_H
+
+#include "boa/gfx/linear.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace boa::gfx {
+
+// Boxes kept as centers and half extents with one array per component, so
+// a frustum test can load several boxes into a register at once.
+class BoxBatch {
+public:
+    void clear();
+    void reserve(size_t count);
+    void push_back(const Box &box);
+
+    size_t size() const {
+        return m_center_x.size();
+    }
+
+    // visible[i] is 1 when box i is at least partly inside the frustum and 0
+    // otherwise. Tests 8 boxes at a time with AVX, 4 with SSE.
+    void cull(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+
+private:
+    std::vector<float> m_center_x, m_center_y, m_center_z;
+    std::vector<float> m_extent_x, m_extent_y, m_extent_z;
+};
+
+}
+
+#endif
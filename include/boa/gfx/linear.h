@@ -4,10 +4,15 @@
 #include "glm/glm.hpp"
 #include "glm/matrix.hpp"
 #include "glm/gtc/quaternion.hpp"
+#include "boa/ecs/component.h"
 #include <vulkan/vulkan.hpp>
 #include <fmt/format.h>
 #include <string>
 
+namespace boa::ecs {
+struct EntityGroup;
+}
+
 namespace boa::gfx {
 
 struct Transformable {
@@ -28,8 +33,48 @@ struct Transformable {
 
     void update();
     void decompose();
+
+    // Stored struct-of-arrays in the ECS (see ComponentStorage below), so
+    // EntityGroup::get_component hands out these instead of a reference.
+    static constexpr auto soa_fields = std::make_tuple(&Transformable::transform_matrix,
+                                                       &Transformable::orientation,
+                                                       &Transformable::translation,
+                                                       &Transformable::scale);
+
+    struct Ref {
+        glm::mat4 &transform_matrix;
+        glm::quat &orientation;
+        glm::vec3 &translation;
+        glm::vec3 &scale;
+
+        void update();
+        void decompose();
+    };
+
+    struct ConstRef {
+        const glm::mat4 &transform_matrix;
+        const glm::quat &orientation;
+        const glm::vec3 &translation;
+        const glm::vec3 &scale;
+    };
+
+    // Recomposes the matrix of every Transformable changed after
+    // `since_version` from its translation, orientation and scale, a block of
+    // TRANSFORM_BATCH_SIZE slots at a time. Every slot of a recomposed block
+    // is marked changed.
+    static void update_changed(ecs::SoaComponentPool<Transformable> &pool, uint32_t since_version);
+
+    // For entities with an ecs::Parent, translation, orientation and scale are
+    // relative to the parent and transform_matrix is the world matrix. Run
+    // after update_changed: walks EntityGroup::hierarchy_order once and
+    // recomputes children whose own or whose parent's transform changed after
+    // `since_version`, so untouched subtrees are skipped.
+    static void update_hierarchy(ecs::EntityGroup &entity_group, uint32_t since_version);
 };
 
+// slots composed together by Transformable::update_changed
+const uint32_t TRANSFORM_BATCH_SIZE = 8;
+
 struct SmallVertex {
     glm::vec3 position;
 
@@ -131,6 +176,12 @@ struct Frustum {
 
 }
 
+namespace boa::ecs {
+
+template <> struct ComponentStorage<gfx::Transformable> : SoaStorage<gfx::Transformable> {};
+
+}
+
 template <> struct fmt::formatter<glm::vec3> {
     constexpr auto parse(format_parse_context &ctx) {
         return ctx.begin();
@@ -0,0 +1,113 @@
+#ifndef BOA_GFX_RENDER_QUEUE_H
+#define BOA_GFX_RENDER_QUEUE_H
+
+#include <array>
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace boa::gfx {
+
+enum class DrawPass : uint32_t {
+    Opaque,
+};
+
+// Render state of a draw packed most significant first: pass, pipeline,
+// descriptor set, material and a depth bucket. Sorting draws by it puts
+// draws sharing state next to each other, nearest first within a material.
+namespace sort_key {
+    constexpr uint32_t PASS_BITS        = 4;
+    constexpr uint32_t PIPELINE_BITS    = 8;
+    constexpr uint32_t DESCRIPTOR_BITS  = 16;
+    constexpr uint32_t MATERIAL_BITS    = 16;
+    constexpr uint32_t DEPTH_BITS       = 20;
+
+    uint64_t make(DrawPass pass, uint32_t pipeline, uint32_t descriptor_set, uint32_t material, uint32_t depth_bucket);
+    // `distance` in [0, `far`] mapped onto DEPTH_BITS, anything further clamps
+    uint32_t depth_bucket(float distance, float far);
+}
+
+// Calls made to the emitter against the ones that reached the command
+// buffer, so the statistics window can show what state sorting saves.
+struct RenderStatistics {
+    struct Count {
+        uint32_t requested{ 0 };
+        uint32_t issued{ 0 };
+
+        Count &operator+=(const Count &other) {
+            requested += other.requested;
+            issued += other.issued;
+            return *this;
+        }
+    };
+
+    Count pipeline_binds;
+    Count descriptor_binds;
+    Count vertex_buffer_binds;
+    Count index_buffer_binds;
+    Count push_constants;
+    // draw calls recorded, indirect ones can hold several draws each
+    uint32_t draw_calls{ 0 };
+    uint32_t draws{ 0 };
+    uint32_t command_buffers{ 0 };
+    // triangles of the instances sent to the GPU cull pass, at the level of
+    // detail picked and as if all were drawn at full detail
+    uint32_t triangles{ 0 };
+    uint32_t full_detail_triangles{ 0 };
+
+    RenderStatistics &operator+=(const RenderStatistics &other);
+};
+
+// Records into a command buffer, dropping binds and push constants that
+// would not change any state.
+class CommandEmitter {
+public:
+    explicit CommandEmitter(vk::CommandBuffer cmd);
+
+    void bind_pipeline(vk::Pipeline pipeline);
+    void bind_descriptor_set(vk::PipelineLayout layout, uint32_t set, vk::DescriptorSet descriptor_set,
+        vk::ArrayProxy<const uint32_t> dynamic_offsets = nullptr);
+    void bind_vertex_buffer(vk::Buffer buffer);
+    void bind_index_buffer(vk::Buffer buffer);
+    void push_constants(vk::PipelineLayout layout, vk::ShaderStageFlags stages, uint32_t size, const void *data);
+
+    void draw_indexed_indirect(vk::Buffer buffer, vk::DeviceSize offset, uint32_t draw_count, uint32_t stride);
+    void draw_indexed(uint32_t index_count);
+    void draw(uint32_t vertex_count, uint32_t first_vertex = 0);
+
+    // after recording commands that bypass the emitter
+    void invalidate();
+
+    const RenderStatistics &statistics() const {
+        return m_statistics;
+    }
+
+private:
+    static constexpr uint32_t MAX_TRACKED_SETS = 4;
+    static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 4;
+    static constexpr uint32_t MAX_PUSH_CONSTANTS_SIZE = 128;
+
+    struct BoundSet {
+        vk::PipelineLayout layout;
+        vk::DescriptorSet set;
+        uint32_t dynamic_offset_count{ 0 };
+        std::array<uint32_t, MAX_DYNAMIC_OFFSETS> dynamic_offsets{};
+
+        bool matches(vk::PipelineLayout other_layout, vk::DescriptorSet other_set, vk::ArrayProxy<const uint32_t> offsets) const;
+    };
+
+    vk::CommandBuffer m_cmd;
+    RenderStatistics m_statistics;
+
+    vk::Pipeline m_pipeline;
+    std::array<BoundSet, MAX_TRACKED_SETS> m_sets;
+    vk::Buffer m_vertex_buffer;
+    vk::Buffer m_index_buffer;
+
+    vk::PipelineLayout m_push_constants_layout;
+    uint32_t m_push_constants_size{ 0 };
+    std::array<uint8_t, MAX_PUSH_CONSTANTS_SIZE> m_push_constants;
+};
+
+}
+
+#endif
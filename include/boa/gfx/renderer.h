@@ -8,10 +8,14 @@
 #include "boa/gfx/window.h"
 #include "boa/gfx/vk/util.h"
 #include "boa/gfx/vk/types.h"
+#include "boa/gfx/vk/ring_buffer.h"
 #include "boa/gfx/lighting.h"
 #include "boa/gfx/asset/gltf_model.h"
 #include "boa/gfx/asset/asset.h"
 #include "boa/gfx/camera.h"
+#include "boa/gfx/render_queue.h"
+#include "boa/gfx/culling.h"
+#include "boa/gfx/scene_index.h"
 #include "boa/gfx/asset/asset_manager.h"
 #include "glm/gtx/transform.hpp"
 #include <functional>
@@ -83,6 +87,11 @@ public:
         return m_transforms.view_projection;
     }
 
+    // binds and draws recorded for the last frame
+    const RenderStatistics &get_render_statistics() const {
+        return m_render_statistics;
+    }
+
     void set_draw_bounding_boxes(bool draw) {
         m_draw_bounding_boxes = draw;
     }
@@ -92,6 +101,9 @@ public:
 
     void set_ui_mouse_enabled(bool mouse_enabled);
 
+    // the renderable whose box is under the cursor, within `length`
+    std::optional<uint32_t> pick_entity(uint32_t cursor_x, uint32_t cursor_y, float length) const;
+
     enum {
         UNTEXTURED_MATERIAL_INDEX,
         TEXTURED_MATERIAL_INDEX,
@@ -125,6 +137,34 @@ private:
 
     constexpr static uint32_t FRAMES_IN_FLIGHT = 2;
     constexpr static uint32_t MAX_IMAGE_DESCRIPTORS = 125;
+    // per frame draw buffers start this big and double when outgrown
+    constexpr static uint32_t INITIAL_OBJECT_CAPACITY = 4096;
+    constexpr static uint32_t INITIAL_BATCH_CAPACITY = 256;
+    // bindings of the object and visible buffers in both the parent and
+    // blinn phong sets
+    constexpr static uint32_t OBJECT_BINDING = 2;
+    constexpr static uint32_t VISIBLE_BINDING = 3;
+    constexpr static uint32_t CULL_WORKGROUP_SIZE = 64;
+    // bytes of uniform data each frame can write to m_uniform_ring
+    constexpr static uint32_t UNIFORM_RING_REGION_SIZE = 64 * 1024;
+    // draw runs recorded by one thread at the least, fewer are not worth a
+    // secondary command buffer of their own
+    constexpr static uint32_t MIN_RUNS_PER_RECORD_CHUNK = 64;
+    // models with at least this many primitives are culled per primitive
+    // on the CPU, not only per entity
+    constexpr static uint32_t MIN_PRIMITIVES_TO_CULL = 16;
+    // enough for a 32768 pixel wide depth pyramid
+    constexpr static uint32_t MAX_DEPTH_PYRAMID_LEVELS = 16;
+    constexpr static uint32_t DEPTH_PYRAMID_WORKGROUP_SIZE = 8;
+    // Bounding sphere diameter, as a fraction of the screen height, below
+    // which each coarser level of detail is drawn. Levels double their error
+    // and so halve these. A level is only left once the size is further
+    // than LOD_HYSTERESIS (relative) past the threshold, so primitives
+    // sitting on one don't switch every frame.
+    constexpr static std::array<float, glTFModel::MAX_LODS - 1> LOD_SCREEN_SIZES = { 0.25f, 0.125f, 0.0625f };
+    constexpr static float LOD_HYSTERESIS = 0.1f;
+    constexpr static float NEAR_PLANE = 0.1f;
+    constexpr static float FAR_PLANE = 500.0f;
 
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphics_family;
@@ -165,15 +205,72 @@ private:
         glm::mat4 model_view_projection;
     };
 
+    // one per primitive instance, laid out like Object in cull.comp
+    struct GPUObject {
+        glm::mat4 model;
+        // world space, xyz is the center and w the radius
+        glm::vec4 bounding_sphere;
+        uint32_t batch;
+        uint32_t padding[3];
+    };
+
+    struct CullConstants {
+        glm::vec4 planes[6];
+        uint32_t object_count;
+    };
+
+    // laid out like Occlusion in cull.comp
+    struct OcclusionConstants {
+        glm::mat4 view;
+        // P00, P11, P22 and P32 of the projection
+        glm::vec4 projection;
+        glm::vec2 pyramid_size;
+        uint32_t pyramid_levels;
+        uint32_t enabled;
+    };
+
+    struct DepthPyramidConstants {
+        glm::uvec2 source_size;
+        glm::uvec2 size;
+        // source texels reduced into one along each axis
+        uint32_t stride;
+    };
+
+    // A thread's pool of secondary command buffers for one frame. Buffers
+    // are reused once the frame's fence has been waited on.
+    struct RecordContext {
+        vk::CommandPool command_pool;
+        std::vector<vk::CommandBuffer> command_buffers;
+        uint32_t used{ 0 };
+    };
+
     struct PerFrame {
         vk::Semaphore present_sem, render_sem;
         vk::Fence render_fence;
         vk::CommandPool command_pool;
         vk::CommandBuffer command_buffer;
+        // everything in the render pass is recorded into secondary command
+        // buffers, one context per ThreadPool thread by thread_index()
+        std::vector<RecordContext> record_contexts;
         vk::DescriptorSet parent_set;
         vk::DescriptorSet parent_blinn_phong_set;
-        VmaBuffer transformations_buffer;
-        VmaBuffer blinn_phong_buffer;
+        // dynamic offsets of this frame's uniforms in m_uniform_ring
+        uint32_t transformations_offset;
+        uint32_t blinn_phong_offset;
+        uint32_t occlusion_offset;
+        // Every primitive instance of the frame, culled on the GPU. The cull
+        // pass counts the survivors of each batch into its indirect command
+        // and writes their object indices into the batch's range of the
+        // visible buffer, which the vertex shaders index by gl_InstanceIndex.
+        vk::DescriptorSet cull_set;
+        VmaBuffer object_buffer;
+        VmaBuffer visible_buffer;
+        VmaBuffer indirect_buffer;
+        // object and indirect buffers stay mapped
+        GPUObject *objects;
+        vk::DrawIndexedIndirectCommand *commands;
+        size_t object_capacity;
+        size_t batch_capacity;
 
         DeletionQueue deletion_queue;
     };
@@ -214,8 +311,20 @@ private:
     vk::DescriptorSetLayout m_textures_set_layout;
     vk::DescriptorSetLayout m_blinn_phong_set_layout;
     vk::DescriptorSetLayout m_skybox_set_layout;
+    vk::DescriptorSetLayout m_cull_set_layout;
     vk::DescriptorPool m_descriptor_pool;
 
+    vk::Pipeline m_cull_pipeline;
+    vk::PipelineLayout m_cull_pipeline_layout;
+
+    vk::DescriptorSetLayout m_depth_pyramid_set_layout;
+    // one per level, reading the level below (the depth image for level 0)
+    vk::DescriptorSet m_depth_pyramid_sets[MAX_DEPTH_PYRAMID_LEVELS];
+    vk::Sampler m_depth_pyramid_sampler;
+    vk::Pipeline m_depth_reduce_pipeline;
+    vk::Pipeline m_depth_resolve_pipeline;
+    vk::PipelineLayout m_depth_pyramid_pipeline_layout;
+
     VmaBuffer m_skybox_index_buffer;
     VmaBuffer m_skybox_vertex_buffer;
     vk::Pipeline m_skybox_pipeline;
@@ -232,15 +341,96 @@ private:
     vk::Framebuffer m_framebuffer;
 
     PerFrame m_frames[FRAMES_IN_FLIGHT];
+    // per frame uniforms, one region per frame in flight
+    RingBuffer m_uniform_ring;
 
     VmaImage m_depth_image;
     vk::ImageView m_depth_image_view;
     vk::Format m_depth_format;
 
+    // Furthest depth of the last frame, halved (rounding up) per level down
+    // to 1x1 and kept in the general layout. The cull pass tests bounding
+    // spheres against it, which is only done once the depth image holds a
+    // rendered frame.
+    VmaImage m_depth_pyramid;
+    vk::ImageView m_depth_pyramid_view;
+    vk::ImageView m_depth_pyramid_level_views[MAX_DEPTH_PYRAMID_LEVELS];
+    uint32_t m_depth_pyramid_levels{ 0 };
+    bool m_depth_pyramid_ready{ false };
+
     VmaImage m_msaa_image;
     vk::ImageView m_msaa_image_view;
 
     Frustum m_frustum;
+    // store version up to which RenderBounds are current
+    uint32_t m_render_bounds_version{ 0 };
+    // world boxes of every renderable, kept in step with RenderBounds
+    SceneIndex m_scene_index;
+    std::vector<uint32_t> m_stale_proxies;
+    // level of detail each renderable's draws had last frame, by scene
+    // proxy then by the draw's place among the entity's draws
+    std::vector<std::vector<uint8_t>> m_proxy_lods;
+
+    // One per primitive of every renderable. Sorting by key (model,
+    // level of detail and primitive) makes the instances of a primitive
+    // at one level contiguous, so each is one batch drawn with a single
+    // indirect draw.
+    struct InstanceDraw {
+        uint64_t key;
+        uint32_t node;
+    };
+
+    static uint64_t draw_key(uint32_t model_id, uint32_t primitive, uint32_t lod) {
+        return (uint64_t(model_id) << 32) | (lod << 28) | primitive;
+    }
+    static uint32_t key_model(uint64_t key) { return static_cast<uint32_t>(key >> 32); }
+    static uint32_t key_primitive(uint64_t key) { return static_cast<uint32_t>(key) & 0x0fffffff; }
+    static uint32_t key_lod(uint64_t key) { return static_cast<uint32_t>(key) >> 28; }
+
+    struct InstanceNode {
+        glm::mat4 transform;
+        glm::vec4 bounding_sphere;
+    };
+
+    struct DrawBatch {
+        uint64_t key;
+        // see sort_key, decides the order batches are drawn in
+        uint64_t state_key;
+        uint32_t first;
+        uint32_t count;
+        // slot in the indirect buffer, the batch's place in m_draw_order
+        uint32_t command;
+    };
+
+    std::vector<InstanceDraw> m_instance_draws;
+    std::vector<InstanceDraw> m_instance_draws_scratch;
+    // node transforms gathered this frame, shared by primitives of a node
+    std::vector<InstanceNode> m_instance_nodes;
+    // world transforms of an animated entity's nodes, by GPUModel::flat_nodes
+    std::vector<glm::mat4> m_node_palette;
+    // renderables whose box is in the frustum this frame
+    std::vector<uint32_t> m_cull_entities;
+    // draws of per primitive culled models, kept if their box is visible
+    std::vector<InstanceDraw> m_primitive_draws;
+    BoxBatch m_primitive_boxes;
+    std::vector<uint8_t> m_cull_visible;
+    // batches stay in key order, they are drawn in m_draw_order
+    std::vector<DrawBatch> m_draw_batches;
+    std::vector<uint32_t> m_draw_order;
+    std::vector<uint32_t> m_draw_order_scratch;
+
+    // consecutive slots of m_draw_order with the same material and
+    // lighting, recorded as one multi draw
+    struct DrawRun {
+        uint32_t first_slot;
+        uint32_t count;
+    };
+
+    std::vector<DrawRun> m_draw_runs;
+    // secondary command buffers executed in the render pass, in order
+    std::vector<vk::CommandBuffer> m_secondary_buffers;
+    std::vector<RenderStatistics> m_secondary_statistics;
+    RenderStatistics m_render_statistics;
     AssetManager m_asset_manager;
     bool m_draw_bounding_boxes{ false };
 
@@ -249,6 +439,17 @@ private:
 
     PerFrame &current_frame();
 
+    void update_render_bounds();
+    void gather_instances();
+    void reserve_draw_buffers(size_t object_count, size_t batch_count);
+    void write_draw_descriptors(PerFrame &frame);
+    // everything before the render pass: uniforms, instances and the cull pass
+    void prepare_renderables(vk::CommandBuffer cmd);
+    void build_depth_pyramid(vk::CommandBuffer cmd);
+    vk::CommandBuffer begin_secondary_commands(RecordContext &context);
+    RenderStatistics record_draw_runs(vk::CommandBuffer cmd, size_t begin, size_t end);
+    RenderStatistics record_overlays(vk::CommandBuffer cmd);
+    // records the render pass contents across the thread pool and executes them
     void draw_renderables(vk::CommandBuffer cmd);
 
     void init_window_user_pointers();
@@ -271,6 +472,7 @@ private:
     void create_pipelines();
     void create_descriptors();
     void create_skybox_resources();
+    void create_depth_pyramid();
 
     void immediate_command(std::function<void(vk::CommandBuffer cmd)> &&function);
 
@@ -278,6 +480,8 @@ private:
     vk::ImageView create_image_view(vk::Image image, vk::Format format,
         vk::ImageAspectFlags aspect_flags, uint32_t mip_levels = 1) const;
     VmaBuffer create_buffer(size_t size, vk::BufferUsageFlags usage, VmaMemoryUsage memory_usage) const;
+    // host visible and coherent, mapped to `mapped` until it is destroyed
+    VmaBuffer create_mapped_buffer(size_t size, vk::BufferUsageFlags usage, void **mapped) const;
 
     SwapChainSupportDetails query_swap_chain_support(vk::PhysicalDevice device) const;
     vk::SampleCountFlagBits get_max_sample_count() const;
@@ -297,6 +501,7 @@ private:
     friend class GPUTexture;
     friend class GPUSkybox;
     friend class DebugDrawer;
+    friend class MeshArena;
 };
 
 }
@@ -0,0 +1,206 @@
+#ifndef BOA_GFX_SCENE_INDEX_H
+#define BOA_GFX_SCENE_INDEX_H
+
+#include "boa/utl/iteration.h"
+#include "boa/utl/macros.h"
+#include "boa/gfx/linear.h"
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+namespace boa::gfx {
+
+// Dynamic AABB tree over the world boxes of entities, one leaf (proxy) per
+// entity. Leaves keep a box fattened by BOX_MARGIN, so small moves change
+// nothing; bigger ones refit the leaf's ancestors in place. Refits and
+// inserts slowly worsen the tree, which is rebuilt with a binned SAH once
+// its cost drifts REBUILD_COST_RATIO above that of the last rebuild.
+//
+// Owned and kept up to date by the Renderer; the rest of the engine reads
+// it through get() for picking and range queries.
+class SceneIndex {
+    REMOVE_COPY_AND_ASSIGN(SceneIndex);
+public:
+    static constexpr uint32_t NO_PROXY = UINT32_MAX;
+    static constexpr float BOX_MARGIN = 0.1f;
+    static constexpr float REBUILD_COST_RATIO = 1.5f;
+
+    SceneIndex();
+    ~SceneIndex();
+    static SceneIndex &get();
+
+    uint32_t insert(uint32_t e_id, const Box &box);
+    void move(uint32_t proxy, const Box &box);
+    void remove(uint32_t proxy);
+    void clear();
+
+    // whether `proxy` is a leaf and holds `e_id`
+    bool contains(uint32_t proxy, uint32_t e_id) const {
+        return proxy < m_nodes.size() && m_nodes[proxy].is_leaf() && m_nodes[proxy].e_id == e_id;
+    }
+
+    uint32_t size() const {
+        return m_leaf_count;
+    }
+
+    // rebuilds if enough changed since the last check and the tree got worse
+    void rebuild_if_degraded();
+    void rebuild();
+
+    // `callback(proxy, e_id)`, leaves may not be removed while visiting
+    template <typename Callback>
+    void for_each_leaf(Callback callback) const {
+        for (uint32_t i = 0; i < m_nodes.size(); i++) {
+            if (m_nodes[i].is_leaf() && m_nodes[i].e_id != NO_ENTITY)
+                callback(i, m_nodes[i].e_id);
+        }
+    }
+
+    // Appends entities whose fattened box touches the frustum. A subtree
+    // entirely inside a plane skips that plane, one entirely inside all of
+    // them is appended without further tests.
+    void cull(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+    // `callback(e_id)` for each entity whose box overlaps, returns Iteration
+    template <typename Callback>
+    void query_box(const Box &box, Callback callback) const {
+        traverse([&](const Node &node) {
+            return overlaps(node.box, box);
+        }, [&](const Node &leaf) {
+            return overlaps(leaf.tight_box, box) ? callback(leaf.e_id) : Iteration::Continue;
+        });
+    }
+
+    template <typename Callback>
+    void query_sphere(const glm::vec3 &center, float radius, Callback callback) const {
+        traverse([&](const Node &node) {
+            return distance_squared(node.box, center) <= radius * radius;
+        }, [&](const Node &leaf) {
+            return distance_squared(leaf.tight_box, center) <= radius * radius ? callback(leaf.e_id) : Iteration::Continue;
+        });
+    }
+
+    // `callback(e_id, enter, exit)` for entities whose box the ray crosses
+    // within `max_distance`, with the distances along the normalized
+    // `direction` where it enters and leaves (enter is 0 from inside). The
+    // callback returns the new max distance, the nearest hit so far for a
+    // closest hit query, so further away subtrees are skipped.
+    template <typename Callback>
+    void raycast(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, Callback callback) const {
+        const glm::vec3 inverse_direction = 1.0f / direction;
+        float enter, exit;
+
+        traverse([&](const Node &node) {
+            return ray_hits(node.box, origin, inverse_direction, max_distance, enter, exit);
+        }, [&](const Node &leaf) {
+            if (ray_hits(leaf.tight_box, origin, inverse_direction, max_distance, enter, exit))
+                max_distance = callback(leaf.e_id, enter, exit);
+            return Iteration::Continue;
+        });
+    }
+
+private:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr uint32_t NO_ENTITY = UINT32_MAX;
+    static constexpr uint32_t SAH_BIN_COUNT = 16;
+
+    struct Node {
+        // fattened for leaves, the union of both children otherwise
+        Box box;
+        // the entity's own box, leaves only
+        Box tight_box;
+        // next free node while on the free list
+        uint32_t parent{ NO_NODE };
+        uint32_t left{ NO_NODE };
+        uint32_t right{ NO_NODE };
+        // NO_ENTITY for internal and free nodes
+        uint32_t e_id{ NO_ENTITY };
+
+        bool is_leaf() const {
+            return left == NO_NODE;
+        }
+    };
+
+    uint32_t allocate_node();
+    void free_node(uint32_t node);
+    void insert_leaf(uint32_t leaf);
+    void remove_leaf(uint32_t leaf);
+    void refit_from(uint32_t node);
+    uint32_t build(std::vector<uint32_t> &leaves, uint32_t begin, uint32_t end);
+    float cost() const;
+
+    static Box merge(const Box &a, const Box &b) {
+        return Box{ glm::min(a.min, b.min), glm::max(a.max, b.max) };
+    }
+
+    static bool encloses(const Box &outer, const Box &inner) {
+        return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outer.max));
+    }
+
+    static bool overlaps(const Box &a, const Box &b) {
+        return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+    }
+
+    // half the surface area, which is all SAH needs to compare boxes
+    static float area(const Box &box) {
+        glm::vec3 size = box.max - box.min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    static float distance_squared(const Box &box, const glm::vec3 &point) {
+        glm::vec3 offset = glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0.0f));
+        return glm::dot(offset, offset);
+    }
+
+    static bool ray_hits(const Box &box, const glm::vec3 &origin, const glm::vec3 &inverse_direction,
+            float max_distance, float &enter, float &exit) {
+        glm::vec3 near_t = (box.min - origin) * inverse_direction;
+        glm::vec3 far_t = (box.max - origin) * inverse_direction;
+        glm::vec3 t_min = glm::min(near_t, far_t);
+        glm::vec3 t_max = glm::max(near_t, far_t);
+
+        enter = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+        exit = std::min(std::min(t_max.x, t_max.y), std::min(t_max.z, max_distance));
+        return enter <= exit;
+    }
+
+    // depth first, into nodes `enter_node` accepts, `visit_leaf` returns
+    // Iteration::Break to stop
+    template <typename EnterNode, typename VisitLeaf>
+    void traverse(EnterNode enter_node, VisitLeaf visit_leaf) const {
+        if (m_root == NO_NODE)
+            return;
+
+        std::vector<uint32_t> stack;
+        stack.push_back(m_root);
+        while (!stack.empty()) {
+            const Node &node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (!enter_node(node))
+                continue;
+
+            if (node.is_leaf()) {
+                if (visit_leaf(node) == Iteration::Break)
+                    return;
+                continue;
+            }
+
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+
+    std::vector<Node> m_nodes;
+    uint32_t m_root{ NO_NODE };
+    uint32_t m_free_head{ NO_NODE };
+    uint32_t m_leaf_count{ 0 };
+
+    // inserts and refits since rebuild_if_degraded last looked at the cost
+    uint32_t m_changes{ 0 };
+    float m_rebuilt_cost{ 0.0f };
+};
+
+}
+
+#endif
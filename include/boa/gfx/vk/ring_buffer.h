@@ -0,0 +1,64 @@
+#ifndef BOA_GFX_VK_RING_BUFFER_H
+#define BOA_GFX_VK_RING_BUFFER_H
+
+#include "boa/gfx/vk/types.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vulkan/vulkan.hpp>
+
+namespace boa::gfx {
+
+// A persistently mapped, host coherent buffer split into one region per
+// frame in flight. Each frame appends its data linearly to its own
+// region, then reuses the region once the frame's fence has been waited
+// on, so nothing is mapped or flushed per frame. Offsets are from the
+// start of the buffer, ready to be used as dynamic descriptor offsets.
+class RingBuffer {
+public:
+    void init(VmaBuffer buffer, void *mapped, uint32_t region_size, uint32_t region_count, uint32_t alignment) {
+        m_buffer = buffer;
+        m_data = static_cast<uint8_t *>(mapped);
+        m_region_size = region_size;
+        m_region_count = region_count;
+        m_alignment = alignment > 0 ? alignment : 1;
+    }
+
+    void begin_frame(uint32_t frame) {
+        m_head = (frame % m_region_count) * m_region_size;
+        m_region_end = m_head + m_region_size;
+    }
+
+    uint32_t write(const void *data, uint32_t size) {
+        uint32_t offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+        if (offset + size > m_region_end)
+            throw std::runtime_error("Ring buffer region is full");
+
+        std::memcpy(m_data + offset, data, size);
+        m_head = offset + size;
+        return offset;
+    }
+
+    template <typename T>
+    uint32_t write(const T &value) {
+        return write(&value, sizeof(T));
+    }
+
+    const VmaBuffer &get_buffer() const {
+        return m_buffer;
+    }
+
+private:
+    VmaBuffer m_buffer{};
+    uint8_t *m_data{ nullptr };
+    uint32_t m_region_size{ 0 };
+    uint32_t m_region_count{ 1 };
+    uint32_t m_alignment{ 1 };
+
+    uint32_t m_head{ 0 };
+    uint32_t m_region_end{ 0 };
+};
+
+}
+
+#endif
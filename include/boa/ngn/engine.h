@@ -1,6 +1,7 @@
 #ifndef BOA_NGN_ENGINE_H
 #define BOA_NGN_ENGINE_H
 
+#include "boa/utl/thread_pool.h"
 #include "boa/ecs/ecs.h"
 #include "boa/gfx/renderer.h"
 #include "boa/gfx/asset/animation.h"
@@ -59,6 +60,11 @@ private:
 
     std::optional<uint32_t> last_selected_entity;
 
+    // the world as it was when physics was last started, restored on stop
+    boa::ecs::Snapshot m_physics_snapshot;
+
+    boa::ThreadPool thread_pool;
+    boa::ecs::CommandQueue command_queue;
     boa::ecs::ComponentStore component_store;
     boa::ecs::EntityGroup entity_group;
 
@@ -74,7 +80,10 @@ private:
     boa::phy::PhysicsController physics_controller;
     boa::ngn::ScriptController script_controller;
 
+    boa::ecs::SystemScheduler system_scheduler;
+
     void setup_input();
+    void setup_systems();
     void input_update(float time_change);
     void deselect_object();
 
@@ -4,5 +4,10 @@
 #include <cstdint>
 
 extern "C" void set_entity_position(uint32_t e_id, float x, float y, float z);
+extern "C" void set_entity_parent(uint32_t e_id, uint32_t parent_e_id);
+extern "C" void remove_entity_parent(uint32_t e_id);
+// writes up to `max_count` renderables within `radius` of the point to
+// `e_ids` and returns how many
+extern "C" uint32_t find_entities_in_radius(float x, float y, float z, float radius, uint32_t *e_ids, uint32_t max_count);
 
 #endif
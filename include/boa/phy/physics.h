@@ -9,6 +9,7 @@
 #include <memory>
 #include <utility>
 #include <functional>
+#include <vector>
 
 namespace boa::gfx {
 class AssetManager;
@@ -59,7 +60,15 @@ public:
     ~PhysicsController();
 
     void add_entity(uint32_t e_id, float f_mass);
+    // also removes the bodies of every descendant of `e_id`
     void remove_entity(uint32_t e_id);
+    void remove_all_entities();
+    // Bodies are not part of an ecs::Snapshot: restoring one leaves Physical
+    // components without bodies, which this recreates from the restored
+    // Transformable along with the saved mass and velocities.
+    void restore_bodies();
+    // drops what a restore that failed part way read, see restore_bodies
+    void clear_pending_bodies();
     float get_entity_mass(uint32_t e_id) const;
     void set_entity_mass(uint32_t e_id, float mass) const;
     void update(float time_change);
@@ -107,6 +116,15 @@ private:
     std::unordered_set<std::pair<uint32_t, uint32_t>, PairHash> m_present_manifolds;
 
     std::function<void(uint32_t, uint32_t)> m_collision_callback;
+
+    struct PendingBody {
+        uint32_t e_id;
+        float mass;
+        glm::vec3 linear_velocity;
+        glm::vec3 angular_velocity;
+    };
+
+    std::vector<PendingBody> m_pending_bodies;
 };
 
 }
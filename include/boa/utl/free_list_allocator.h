@@ -0,0 +1,43 @@
+#ifndef BOA_UTL_FREE_LIST_ALLOCATOR_H
+#define BOA_UTL_FREE_LIST_ALLOCATOR_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace boa {
+
+// Hands out ranges of [0, capacity) in whatever unit the owner uses, e.g.
+// vertices of a shared buffer. Free ranges are kept sorted by offset and
+// merged with their neighbours when freed, allocation takes the first
+// range that fits.
+class FreeListAllocator {
+public:
+    explicit FreeListAllocator(uint32_t capacity = 0);
+
+    std::optional<uint32_t> allocate(uint32_t size);
+    void free(uint32_t offset, uint32_t size);
+
+    // makes [capacity(), new_capacity) allocatable, existing ranges stay put
+    void grow(uint32_t new_capacity);
+    // frees everything at once
+    void clear();
+
+    uint32_t capacity() const {
+        return m_capacity;
+    }
+
+    uint32_t used() const {
+        return m_used;
+    }
+
+private:
+    // offset to size
+    std::map<uint32_t, uint32_t> m_free_ranges;
+    uint32_t m_capacity{ 0 };
+    uint32_t m_used{ 0 };
+};
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef BOA_UTL_RADIX_SORT_H
+#define BOA_UTL_RADIX_SORT_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace boa {
+
+// Stable least significant digit radix sort on a 64 bit key, one byte per
+// pass. Passes where every key has the same byte are skipped, so keys that
+// only use a few bits cost a few passes. `scratch` is resized as needed and
+// can be kept around to avoid reallocating every call.
+template <typename T, typename KeyFunction>
+void radix_sort(std::vector<T> &items, std::vector<T> &scratch, KeyFunction key) {
+    constexpr size_t RADIX = 256;
+    constexpr size_t PASSES = sizeof(uint64_t);
+
+    if (items.size() < 2)
+        return;
+
+    std::array<std::array<size_t, RADIX>, PASSES> counts{};
+    for (const T &item : items) {
+        uint64_t k = key(item);
+        for (size_t pass = 0; pass < PASSES; pass++)
+            counts[pass][(k >> (pass * 8)) & 0xff]++;
+    }
+
+    scratch.resize(items.size());
+
+    for (size_t pass = 0; pass < PASSES; pass++) {
+        auto &count = counts[pass];
+        uint64_t shared_byte = (key(items.front()) >> (pass * 8)) & 0xff;
+        if (count[shared_byte] == items.size())
+            continue;
+
+        size_t offset = 0;
+        for (size_t &bucket : count) {
+            size_t bucket_size = bucket;
+            bucket = offset;
+            offset += bucket_size;
+        }
+
+        for (T &item : items)
+            scratch[count[(key(item) >> (pass * 8)) & 0xff]++] = std::move(item);
+        items.swap(scratch);
+    }
+}
+
+}
+
+#endif
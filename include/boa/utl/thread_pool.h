@@ -0,0 +1,94 @@
+#ifndef BOA_UTL_THREAD_POOL_H
+#define BOA_UTL_THREAD_POOL_H
+
+#include "boa/utl/macros.h"
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace boa {
+
+// Work-stealing task pool. Every thread has its own queue: owners push and
+// pop at the back, idle threads steal from the front of the others. Threads
+// waiting on tasks run queued tasks meanwhile, so tasks may themselves
+// submit and wait (e.g. a parallel_for inside a scheduled system).
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // tracks a batch of submitted tasks, the first exception is kept for wait()
+    struct TaskGroup {
+        std::atomic<uint32_t> pending{ 0 };
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+    };
+
+    explicit ThreadPool(uint32_t worker_count = default_worker_count());
+    ~ThreadPool();
+    REMOVE_COPY_AND_ASSIGN(ThreadPool);
+
+    static ThreadPool &get();
+    static uint32_t default_worker_count();
+
+    uint32_t worker_count() const {
+        return m_workers.size();
+    }
+
+    // workers plus the calling thread
+    uint32_t thread_count() const {
+        return m_workers.size() + 1;
+    }
+
+    // 1..worker_count() on workers, 0 on any other thread
+    static uint32_t thread_index();
+
+    void submit(TaskGroup &group, Task &&task);
+
+    // runs queued tasks until every task of `group` finished, then rethrows
+    // the first exception one of them threw
+    void wait(TaskGroup &group);
+
+    // runs one queued task if there is any
+    bool run_pending_task();
+
+    // Calls `task(begin, end)` for consecutive chunks of at most
+    // `chunk_size` indices covering [0, count) and blocks until every chunk
+    // finished. The first exception thrown by a chunk is rethrown here.
+    void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)> &task);
+
+private:
+    struct Entry {
+        Task task;
+        TaskGroup *group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Entry> entries;
+    };
+
+    std::vector<std::thread> m_workers;
+    // indexed by thread_index()
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<uint32_t> m_queued{ 0 };
+
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_work_available;
+    bool m_stopping{ false };
+
+    void worker_loop(uint32_t index);
+    bool pop_task(uint32_t index, Entry &entry);
+    static void run_task(Entry &entry);
+};
+
+}
+
+#endif
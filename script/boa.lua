@@ -1,12 +1,38 @@
 local ffi = require("ffi")
 ffi.cdef[[
 void set_entity_position(uint32_t e_id, float x, float y, float z);
+void set_entity_parent(uint32_t e_id, uint32_t parent_e_id);
+void remove_entity_parent(uint32_t e_id);
+uint32_t find_entities_in_radius(float x, float y, float z, float radius, uint32_t *e_ids, uint32_t max_count);
 ]]
 
 function set_position_impl(entity, x, y, z)
     ffi.C.set_entity_position(entity, x, y, z)
 end
 
+function set_parent_impl(entity, parent)
+    ffi.C.set_entity_parent(entity, parent)
+end
+
+function remove_parent_impl(entity)
+    ffi.C.remove_entity_parent(entity)
+end
+
+function find_in_radius_impl(x, y, z, radius, max_count)
+    max_count = max_count or 256
+    local e_ids = ffi.new("uint32_t[?]", max_count)
+    local count = ffi.C.find_entities_in_radius(x, y, z, radius, e_ids, max_count)
+
+    local found = {}
+    for i = 0, count - 1 do
+        found[i + 1] = e_ids[i]
+    end
+    return found
+end
+
 return {
-    set_position = set_position_impl
+    set_position = set_position_impl,
+    set_parent = set_parent_impl,
+    remove_parent = remove_parent_impl,
+    find_in_radius = find_in_radius_impl
 }
@@ -18,6 +18,21 @@ layout(set = 0, binding = 0) uniform Transformations {
     mat4 view_projection;
 } transform;
 
+struct Object {
+    mat4 model;
+    vec4 bounding_sphere;
+    uint batch;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Objects {
+    Object objects[];
+} objects;
+
+// written by cull.comp, gl_InstanceIndex includes the batch's first instance
+layout(std430, set = 0, binding = 3) readonly buffer Visible {
+    uint indices[];
+} visible;
+
 layout(push_constant) uniform constants {
     ivec4 padding_and_color_type;
     vec4 base_color;
@@ -25,11 +40,12 @@ layout(push_constant) uniform constants {
 } push_constants;
 
 void main() {
-    gl_Position = transform.view_projection * push_constants.model * vec4(inPosition, 1.0f);
+    mat4 model = objects.objects[visible.indices[gl_InstanceIndex]].model;
+    gl_Position = transform.view_projection * model * vec4(inPosition, 1.0f);
 
-    //outNormal = mat3(transpose(inverse(push_constants.model))) * inNormal;
+    //outNormal = mat3(transpose(inverse(model))) * inNormal;
     outNormal = inNormal;
-    outPosition = vec3(push_constants.model * vec4(inPosition, 1.0));
+    outPosition = vec3(model * vec4(inPosition, 1.0));
 
     switch (push_constants.padding_and_color_type.y) {
     case COLOR_BASE_COLOR:
@@ -16,6 +16,21 @@ layout(set = 0, binding = 0) uniform Transformations {
     mat4 skybox_view_projection;
 } transform;
 
+struct Object {
+    mat4 model;
+    vec4 bounding_sphere;
+    uint batch;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Objects {
+    Object objects[];
+} objects;
+
+// written by cull.comp, gl_InstanceIndex includes the batch's first instance
+layout(std430, set = 0, binding = 3) readonly buffer Visible {
+    uint indices[];
+} visible;
+
 layout(push_constant) uniform constants {
     ivec4 image_descriptor_and_padding;
     vec4 extra1;
@@ -23,7 +38,7 @@ layout(push_constant) uniform constants {
 } push_constants;
 
 void main() {
-    gl_Position = push_constants.model_view_projection * vec4(inPosition, 1.0f);
+    gl_Position = transform.view_projection * objects.objects[visible.indices[gl_InstanceIndex]].model * vec4(inPosition, 1.0f);
     outColor = inColor;
     outTexCoord = inTexCoord;
     imageDescriptor = push_constants.image_descriptor_and_padding.x;
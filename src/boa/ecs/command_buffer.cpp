@@ -0,0 +1,76 @@
+#include "boa/ecs/command_buffer.h"
+#include "boa/utl/thread_pool.h"
+#include <algorithm>
+
+namespace boa::ecs {
+
+void CommandBuffer::apply(EntityGroup &entity_group) {
+    std::vector<uint32_t> created(m_create_count);
+    for (uint32_t &e_id : created)
+        e_id = entity_group.new_entity();
+
+    const auto resolve = [&](const Target &target) {
+        return target.pending ? created[target.id] : target.id;
+    };
+
+    // walking one pool at a time in slot order keeps playback cache friendly
+    std::stable_sort(m_operations.begin(), m_operations.end(), [&](const ComponentCommand &a, const ComponentCommand &b) {
+        if (a.c_id != b.c_id)
+            return a.c_id < b.c_id;
+        return entity_index(resolve(a.target)) < entity_index(resolve(b.target));
+    });
+
+    for (auto &command : m_operations)
+        command.operation->apply(entity_group, resolve(command.target));
+
+    for (auto &callback : m_callbacks)
+        callback();
+
+    std::sort(m_deletions.begin(), m_deletions.end(), [&](const Target &a, const Target &b) {
+        return entity_index(resolve(a)) < entity_index(resolve(b));
+    });
+
+    for (const auto &target : m_deletions)
+        entity_group.delete_entity(resolve(target));
+
+    clear();
+}
+
+void CommandBuffer::clear() {
+    m_create_count = 0;
+    m_operations.clear();
+    m_callbacks.clear();
+    m_deletions.clear();
+}
+
+static CommandQueue *command_queue_instance = nullptr;
+
+CommandQueue::CommandQueue(uint32_t thread_count)
+    : m_buffers(thread_count)
+{
+    if (command_queue_instance)
+        return;
+    command_queue_instance = this;
+}
+
+CommandQueue &CommandQueue::get() {
+    if (!command_queue_instance)
+        throw std::runtime_error("Attempted to get CommandQueue before construction");
+    return *command_queue_instance;
+}
+
+CommandBuffer &CommandQueue::local() {
+    uint32_t thread_index = ThreadPool::thread_index();
+    if (thread_index >= m_buffers.size())
+        throw std::runtime_error("Attempted to record commands from a thread without a command buffer");
+    return m_buffers[thread_index];
+}
+
+void CommandQueue::flush(EntityGroup &entity_group) {
+    for (auto &buffer : m_buffers) {
+        if (!buffer.empty())
+            buffer.apply(entity_group);
+    }
+}
+
+}
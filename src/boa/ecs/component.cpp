@@ -8,10 +8,15 @@ namespace boa::ecs {
 
 static ComponentStore *component_store_instance = nullptr;
 
+uint32_t next_component_id() {
+    if (component_type_count >= MAX_COMPONENT_TYPES)
+        throw std::runtime_error(fmt::format("Exceeded maximum of {} component types", MAX_COMPONENT_TYPES));
+    return component_type_count++;
+}
+
 ComponentStore::ComponentStore() {
     if (component_store_instance)
         return;
-    m_component_store = std::make_unique<char[]>(COMPONENTS_START_COUNT * COMPONENT_ZONE_SIZE);
     component_store_instance = this;
 }
 
@@ -21,16 +26,37 @@ ComponentStore &ComponentStore::get() {
     return *component_store_instance;
 }
 
-void ComponentStore::grow() {
-    size_t old_size = m_growth * COMPONENTS_START_COUNT * COMPONENT_ZONE_SIZE;
-    m_growth *= COMPONENTS_GROWTH_RATE;
-    char *new_store = new char[m_growth * COMPONENTS_START_COUNT * COMPONENT_ZONE_SIZE];
-    memcpy(new_store, m_component_store.get(), old_size);
-    m_component_store.reset(new_store);
+void ComponentStore::clear() {
+    for (auto &pool : m_pools) {
+        if (pool)
+            pool->clear();
+    }
+}
+
+void ComponentStore::save(SnapshotWriter &writer) const {
+    uint32_t pool_count = std::count_if(m_pools.begin(), m_pools.end(), [](const auto &pool) { return pool != nullptr; });
+    writer.write(pool_count);
+
+    for (uint32_t c_id = 0; c_id < m_pools.size(); c_id++) {
+        if (!m_pools[c_id])
+            continue;
+        writer.write(c_id);
+        m_pools[c_id]->save(writer);
+    }
 }
 
-size_t ComponentStore::max_components() const {
-    return m_growth * COMPONENTS_START_COUNT;
+void ComponentStore::restore(SnapshotReader &reader) {
+    // pools created since the snapshot was taken end up empty
+    clear();
+
+    uint32_t pool_count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < pool_count; i++) {
+        uint32_t c_id = reader.read<uint32_t>();
+        ComponentPoolBase *pool = get_pool_from_component_id(c_id);
+        if (!pool)
+            throw std::runtime_error(fmt::format("Snapshot contains unknown component {}", c_id));
+        pool->restore(reader);
+    }
 }
 
 }
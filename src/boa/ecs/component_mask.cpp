@@ -0,0 +1,33 @@
+#include "boa/ecs/component_mask.h"
+
+namespace boa::ecs {
+
+size_t match_component_masks(const ComponentMask *masks, size_t count, const ComponentMask &required,
+                             uint32_t first_index, uint32_t *out) {
+    size_t matched = 0;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    // two masks per register, the required mask is broadcast to both lanes
+    __m256i req = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(required.words)));
+    for (; i + 2 <= count; i += 2) {
+        __m256i pair = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + i));
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_and_si256(pair, req), req);
+        int bits = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+
+        out[matched] = first_index + i;
+        matched += (bits & 0x3) == 0x3;
+        out[matched] = first_index + i + 1;
+        matched += (bits & 0xC) == 0xC;
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[matched] = first_index + i;
+        matched += masks[i].contains_all(required);
+    }
+
+    return matched;
+}
+
+}
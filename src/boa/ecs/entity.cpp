@@ -1,21 +1,27 @@
 #include "boa/ecs/entity.h"
+#include "boa/utl/macros.h"
 #include <cassert>
 #include <algorithm>
+#include <utility>
 
 namespace boa::ecs {
 
 EntityGroup *entity_group_instance = nullptr;
 
-void EntityMeta::grow_if_needed(uint32_t id) {
-    if (id >= component_mask.size())
-        component_mask.resize(component_mask.size() * COMPONENTS_GROWTH_RATE);
-    assert(component_mask.size() <= ComponentStore::get().max_components());
-}
-
 EntityGroup::EntityGroup() {
     if (entity_group_instance)
         return;
     else entity_group_instance = this;
+
+    ComponentStore::get().register_serializer<Children>(
+        [](const Children &children, SnapshotWriter &writer) {
+            writer.write_vector(children.e_ids);
+        },
+        [](SnapshotReader &reader) {
+            Children children;
+            reader.read_vector(children.e_ids);
+            return children;
+        });
 }
 
 EntityGroup &EntityGroup::get() {
@@ -25,28 +31,316 @@ EntityGroup &EntityGroup::get() {
 }
 
 uint32_t EntityGroup::new_entity() {
-    if (free_entities.size() > 0) {
-        uint32_t free_ret = free_entities.back();
-        free_entities.pop_back();
-        entities[free_ret].active = true;
-        return free_ret;
+    if (m_free_head != NO_FREE_ENTITY) {
+        uint32_t index = m_free_head;
+        uint32_t free_slot = m_entities[index];
+        m_free_head = entity_index(free_slot);
+        m_free_count--;
+
+        m_entities[index] = make_entity_handle(index, entity_generation(free_slot));
+        return m_entities[index];
     }
 
-    entities.emplace_back(entities.size());
-    return entities.size() - 1;
+    if (m_entities.size() >= MAX_ENTITIES)
+        throw std::runtime_error(fmt::format("Exceeded maximum of {} entities", MAX_ENTITIES));
+
+    uint32_t e_id = make_entity_handle(m_entities.size(), 0);
+    m_entities.push_back(e_id);
+    m_component_masks.emplace_back();
+    return e_id;
+}
+
+uint32_t EntityGroup::copy_entity(uint32_t copy_e_id) {
+    if (!is_valid(copy_e_id))
+        throw std::runtime_error("Attempted to copy non-existent entity");
+
+    uint32_t new_e_id = new_entity();
+
+    // hierarchy links are not copied as is, see set_parent below
+    ComponentMask copy_mask = m_component_masks[entity_index(copy_e_id)];
+    copy_mask.reset(component_id<Parent>());
+    copy_mask.reset(component_id<Children>());
+
+    auto &component_store = ComponentStore::get();
+    for (uint32_t c_id = 0; c_id < component_type_count; c_id++) {
+        if (copy_mask.test(c_id))
+            component_store.get_pool_from_component_id(c_id)->copy(copy_e_id, new_e_id);
+    }
+
+    m_component_masks[entity_index(new_e_id)] = copy_mask;
+    update_views(new_e_id, ComponentMask{});
+
+    if (has_component<Parent>(copy_e_id))
+        set_parent(new_e_id, std::as_const(*this).get_component<Parent>(copy_e_id).e_id);
+
+    return new_e_id;
+}
+
+EntityRange EntityGroup::instantiate(uint32_t prototype, uint32_t count) {
+    ComponentMask every_component;
+    for (auto &word : every_component.words)
+        word = ~uint64_t(0);
+    return instantiate(prototype, count, every_component);
+}
+
+EntityRange EntityGroup::instantiate(uint32_t prototype, uint32_t count, const ComponentMask &components) {
+    if (!is_valid(prototype))
+        throw std::runtime_error("Attempted to instantiate non-existent entity");
+    if (m_entities.size() + count > MAX_ENTITIES)
+        throw std::runtime_error(fmt::format("Exceeded maximum of {} entities", MAX_ENTITIES));
+
+    EntityRange range;
+    range.first = make_entity_handle(m_entities.size(), 0);
+    range.count = count;
+    if (count == 0)
+        return range;
+
+    ComponentMask prototype_mask = m_component_masks[entity_index(prototype)];
+    for (uint32_t i = 0; i < ComponentMask::WORD_COUNT; i++)
+        prototype_mask.words[i] &= components.words[i];
+    prototype_mask.reset(component_id<Parent>());
+    prototype_mask.reset(component_id<Children>());
+
+    m_entities.reserve(m_entities.size() + count);
+    for (uint32_t e_id : range)
+        m_entities.push_back(e_id);
+    m_component_masks.resize(m_component_masks.size() + count, prototype_mask);
+
+    auto &component_store = ComponentStore::get();
+    for (uint32_t c_id = 0; c_id < component_type_count; c_id++) {
+        if (prototype_mask.test(c_id))
+            component_store.get_pool_from_component_id(c_id)->copy_to_range(prototype, range.first, count);
+    }
+
+    for (auto &view : m_views) {
+        if (!prototype_mask.contains_all(view->required()))
+            continue;
+        view->reserve(count);
+        for (uint32_t e_id : range)
+            view->insert(e_id);
+    }
+
+    if (components.test(component_id<Parent>()) && has_component<Parent>(prototype)) {
+        uint32_t parent_e_id = std::as_const(*this).get_component<Parent>(prototype).e_id;
+        auto &siblings = get_component<Children>(parent_e_id).e_ids;
+        siblings.reserve(siblings.size() + count);
+        for (uint32_t e_id : range)
+            set_parent(e_id, parent_e_id);
+    }
+
+    return range;
 }
 
 void EntityGroup::delete_entity(uint32_t e_id) {
-    if (e_id >= entities.size())
+    if (!is_valid(e_id))
+        return;
+
+    if (has_component<Children>(e_id)) {
+        // each deletion detaches that child from the list, so walk a copy
+        const std::vector<uint32_t> children = std::as_const(*this).get_component<Children>(e_id).e_ids;
+        for (uint32_t child_e_id : children)
+            delete_entity(child_e_id);
+    }
+    remove_parent(e_id);
+
+    uint32_t index = entity_index(e_id);
+
+    auto &component_store = ComponentStore::get();
+    ComponentMask &component_mask = m_component_masks[index];
+    for (uint32_t c_id = 0; c_id < component_type_count; c_id++) {
+        if (component_mask.test(c_id))
+            component_store.get_pool_from_component_id(c_id)->remove(e_id);
+    }
+    const ComponentMask old_mask = component_mask;
+    component_mask.clear();
+    update_views(e_id, old_mask);
+
+    m_free_count++;
+
+    // a wrapped generation would make old copies of `e_id` valid again
+    if (entity_generation(e_id) == ENTITY_GENERATION_MASK) {
+        m_entities[index] = make_entity_handle(NO_FREE_ENTITY, 0);
         return;
-    entities[e_id].active = false;
-    if (std::find(free_entities.cbegin(), free_entities.cend(), e_id) == free_entities.cend())
-        free_entities.push_back(e_id);
+    }
+
+    // bumping the generation here invalidates every outstanding copy of `e_id`
+    m_entities[index] = make_entity_handle(m_free_head, entity_generation(e_id) + 1);
+    m_free_head = index;
 }
 
 void EntityGroup::clear_entities() {
-    free_entities.clear();
-    entities.clear();
+    ComponentStore::get().clear();
+    m_entities.clear();
+    m_component_masks.clear();
+    m_free_head = NO_FREE_ENTITY;
+    m_free_count = 0;
+    m_hierarchy_order.clear();
+    m_hierarchy_dirty = false;
+
+    // views stay registered, only their contents go
+    for (auto &view : m_views)
+        view->clear();
+}
+
+void EntityGroup::snapshot(Snapshot &snapshot) const {
+    snapshot.data.clear();
+    SnapshotWriter writer(snapshot.data);
+
+    writer.write(SNAPSHOT_MAGIC);
+    writer.write(component_type_count);
+    writer.write_vector(m_entities);
+    writer.write_vector(m_component_masks);
+    writer.write(m_free_head);
+    writer.write(m_free_count);
+
+    ComponentStore::get().save(writer);
+}
+
+void EntityGroup::restore(const Snapshot &snapshot) {
+    SnapshotReader reader(snapshot.data);
+
+    try {
+        if (reader.read<uint32_t>() != SNAPSHOT_MAGIC)
+            throw std::runtime_error("Attempted to restore invalid snapshot");
+        // ids handed out after the snapshot was taken are fine, fewer are not
+        if (reader.read<uint32_t>() > component_type_count)
+            throw std::runtime_error("Attempted to restore snapshot from another process");
+
+        reader.read_vector(m_entities);
+        reader.read_vector(m_component_masks);
+        m_free_head = reader.read<uint32_t>();
+        m_free_count = reader.read<uint32_t>();
+        if (m_entities.size() != m_component_masks.size())
+            throw std::runtime_error("Attempted to restore invalid snapshot");
+
+        ComponentStore::get().restore(reader);
+    } catch (...) {
+        clear_entities();
+        throw;
+    }
+
+    for (auto &view : m_views) {
+        view->clear();
+        fill_view(*view);
+    }
+    m_hierarchy_dirty = true;
+}
+
+void EntityGroup::set_parent(uint32_t e_id, uint32_t parent_e_id) {
+    if (!is_valid(e_id) || !is_valid(parent_e_id))
+        throw std::runtime_error("Attempted to parent non-existent entity");
+
+    for (uint32_t ancestor = parent_e_id; ; ancestor = std::as_const(*this).get_component<Parent>(ancestor).e_id) {
+        if (ancestor == e_id)
+            throw std::runtime_error("Attempted to parent entity to itself or one of its descendants");
+        if (!has_component<Parent>(ancestor))
+            break;
+    }
+
+    remove_parent(e_id);
+
+    enable_and_make<Parent>(e_id, parent_e_id);
+    if (!has_component<Children>(parent_e_id))
+        enable<Children>(parent_e_id);
+    get_component<Children>(parent_e_id).e_ids.push_back(e_id);
+
+    mark_all_changed(e_id);
+    m_hierarchy_dirty = true;
+}
+
+void EntityGroup::remove_parent(uint32_t e_id) {
+    if (!has_component<Parent>(e_id))
+        return;
+
+    uint32_t parent_e_id = std::as_const(*this).get_component<Parent>(e_id).e_id;
+    auto &siblings = get_component<Children>(parent_e_id).e_ids;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), e_id));
+    if (siblings.empty())
+        disable<Children>(parent_e_id);
+
+    disable<Parent>(e_id);
+
+    mark_all_changed(e_id);
+    m_hierarchy_dirty = true;
+}
+
+const std::vector<HierarchyLink> &EntityGroup::hierarchy_order() const {
+    if (!m_hierarchy_dirty)
+        return m_hierarchy_order;
+
+    m_hierarchy_order.clear();
+
+    const auto append_children = [&](uint32_t parent_e_id) {
+        for (uint32_t child_e_id : get_component<Children>(parent_e_id).e_ids)
+            m_hierarchy_order.push_back(HierarchyLink{ child_e_id, parent_e_id });
+    };
+
+    for_each_entity_with_component<Children>([&](uint32_t e_id) {
+        if (!has_component<Parent>(e_id))
+            append_children(e_id);
+        return Iteration::Continue;
+    });
+
+    // the list grows while we walk it, which makes this a breadth-first walk
+    for (size_t i = 0; i < m_hierarchy_order.size(); i++) {
+        uint32_t e_id = m_hierarchy_order[i].e_id;
+        if (has_component<Children>(e_id))
+            append_children(e_id);
+    }
+
+    m_hierarchy_dirty = false;
+    return m_hierarchy_order;
+}
+
+void EntityGroup::mark_all_changed(uint32_t e_id) {
+    auto &component_store = ComponentStore::get();
+    const ComponentMask &component_mask = m_component_masks[entity_index(e_id)];
+    for (uint32_t c_id = 0; c_id < component_type_count; c_id++) {
+        if (component_mask.test(c_id))
+            component_store.get_pool_from_component_id(c_id)->mark_changed(e_id);
+    }
+}
+
+const View &EntityGroup::get_view(const ComponentMask &required) const {
+    for (const auto &view : m_views) {
+        if (view->required() == required)
+            return *view;
+    }
+
+    auto view = std::make_unique<View>(required);
+    fill_view(*view);
+
+    m_views.push_back(std::move(view));
+    return *m_views.back();
+}
+
+void EntityGroup::fill_view(View &view) const {
+    uint32_t matched[QUERY_BLOCK_SIZE];
+    for (size_t first = 0; first < m_component_masks.size(); first += QUERY_BLOCK_SIZE) {
+        size_t count = std::min(QUERY_BLOCK_SIZE, m_component_masks.size() - first);
+        size_t matched_count = match_component_masks(m_component_masks.data() + first, count, view.required(), first, matched);
+        // free slots have empty masks, so every match is a live entity
+        for (size_t i = 0; i < matched_count; i++)
+            view.insert(m_entities[matched[i]]);
+    }
+}
+
+void EntityGroup::update_views(uint32_t e_id, const ComponentMask &old_mask) {
+    const ComponentMask &new_mask = m_component_masks[entity_index(e_id)];
+    for (auto &view : m_views)
+        view->update(e_id, old_mask, new_mask);
+}
+
+void EntityGroup::set_component_bit(uint32_t e_id, uint32_t c_id) {
+    const ComponentMask old_mask = m_component_masks[entity_index(e_id)];
+    m_component_masks[entity_index(e_id)].set(c_id);
+    update_views(e_id, old_mask);
+}
+
+void EntityGroup::reset_component_bit(uint32_t e_id, uint32_t c_id) {
+    const ComponentMask old_mask = m_component_masks[entity_index(e_id)];
+    m_component_masks[entity_index(e_id)].reset(c_id);
+    update_views(e_id, old_mask);
 }
 
 }
@@ -0,0 +1,117 @@
+#include "boa/ecs/scheduler.h"
+#include <chrono>
+#include <thread>
+
+namespace boa::ecs {
+
+bool SystemAccess::conflicts_with(const SystemAccess &other) const {
+    if (is_exclusive || other.is_exclusive)
+        return true;
+    return writes.intersects(other.reads) || writes.intersects(other.writes) || reads.intersects(other.writes);
+}
+
+void SystemScheduler::add_system(std::string &&name, const SystemAccess &access, SystemFunction &&function) {
+    m_timings.push_back(SystemTiming{ name, 0.0f });
+    m_systems.push_back(System{ std::move(name), access, std::move(function), {}, 0 });
+    m_graph_dirty = true;
+}
+
+void SystemScheduler::build_graph() {
+    for (auto &system : m_systems) {
+        system.successors.clear();
+        system.predecessor_count = 0;
+    }
+
+    // an edge from every earlier conflicting system keeps registration order
+    for (uint32_t later = 0; later < m_systems.size(); later++) {
+        for (uint32_t earlier = 0; earlier < later; earlier++) {
+            if (m_systems[earlier].access.conflicts_with(m_systems[later].access)) {
+                m_systems[earlier].successors.push_back(later);
+                m_systems[later].predecessor_count++;
+            }
+        }
+    }
+
+    m_remaining = std::make_unique<std::atomic<uint32_t>[]>(m_systems.size());
+    m_graph_dirty = false;
+}
+
+void SystemScheduler::run(float time_change) {
+    if (m_systems.empty())
+        return;
+    if (m_graph_dirty)
+        build_graph();
+
+    auto &thread_pool = ThreadPool::get();
+
+    for (uint32_t system_id = 0; system_id < m_systems.size(); system_id++)
+        m_remaining[system_id].store(m_systems[system_id].predecessor_count, std::memory_order_relaxed);
+    m_finished.store(0, std::memory_order_relaxed);
+    m_exception = nullptr;
+
+    ThreadPool::TaskGroup group;
+    for (uint32_t system_id = 0; system_id < m_systems.size(); system_id++) {
+        if (m_systems[system_id].predecessor_count == 0)
+            schedule(system_id, group, time_change);
+    }
+
+    // this thread runs the exclusive systems and helps with the rest
+    while (m_finished.load(std::memory_order_acquire) < m_systems.size()) {
+        std::optional<uint32_t> exclusive_id;
+        {
+            std::lock_guard<std::mutex> lock(m_exclusive_mutex);
+            if (!m_exclusive_ready.empty()) {
+                exclusive_id = m_exclusive_ready.back();
+                m_exclusive_ready.pop_back();
+            }
+        }
+
+        if (exclusive_id.has_value())
+            execute(exclusive_id.value(), group, time_change);
+        else if (!thread_pool.run_pending_task())
+            std::this_thread::yield();
+    }
+
+    thread_pool.wait(group);
+
+    if (m_exception)
+        std::rethrow_exception(m_exception);
+}
+
+void SystemScheduler::schedule(uint32_t system_id, ThreadPool::TaskGroup &group, float time_change) {
+    if (m_systems[system_id].access.is_exclusive) {
+        std::lock_guard<std::mutex> lock(m_exclusive_mutex);
+        m_exclusive_ready.push_back(system_id);
+        return;
+    }
+
+    ThreadPool::get().submit(group, [this, system_id, &group, time_change]() {
+        execute(system_id, group, time_change);
+    });
+}
+
+void SystemScheduler::execute(uint32_t system_id, ThreadPool::TaskGroup &group, float time_change) {
+    System &system = m_systems[system_id];
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    try {
+        system.function(time_change);
+    } catch (...) {
+        // successors still run so that the frame finishes, run() rethrows
+        std::lock_guard<std::mutex> lock(m_exception_mutex);
+        if (!m_exception)
+            m_exception = std::current_exception();
+    }
+    auto stop_time = std::chrono::high_resolution_clock::now();
+    m_timings[system_id].milliseconds =
+        std::chrono::duration<float, std::chrono::milliseconds::period>(stop_time - start_time).count();
+
+    for (uint32_t successor : system.successors) {
+        if (m_remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            schedule(successor, group, time_change);
+    }
+
+    m_finished.fetch_add(1, std::memory_order_release);
+}
+
+}
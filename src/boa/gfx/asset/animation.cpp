@@ -8,6 +8,85 @@
 
 namespace boa::gfx {
 
+using AnimationTarget = std::variant<glm::vec3, glm::quat>;
+
+static void save_target(const AnimationTarget &target, ecs::SnapshotWriter &writer) {
+    writer.write<uint8_t>(target.index());
+    if (std::holds_alternative<glm::vec3>(target))
+        writer.write(std::get<glm::vec3>(target));
+    else
+        writer.write(std::get<glm::quat>(target));
+}
+
+static AnimationTarget load_target(ecs::SnapshotReader &reader) {
+    if (reader.read<uint8_t>() == 0)
+        return reader.read<glm::vec3>();
+    return reader.read<glm::quat>();
+}
+
+static void save_animated(const Animated &animated, ecs::SnapshotWriter &writer) {
+    writer.write<uint64_t>(animated.animations.size());
+    for (const auto &animation : animated.animations) {
+        writer.write<uint64_t>(animation.animation_components.size());
+        for (const auto &component : animation.animation_components) {
+            writer.write<uint64_t>(component.sub_components.size());
+            for (const auto &sub_component : component.sub_components) {
+                save_target(sub_component.target_start, writer);
+                save_target(sub_component.target_end, writer);
+                writer.write(sub_component.start_time);
+                writer.write(sub_component.end_time);
+            }
+            save_target(component.target_start, writer);
+            save_target(component.target_progress, writer);
+            writer.write(component.current_sub_component);
+            writer.write(component.node_id);
+            writer.write(component.type);
+            writer.write(component.interpolation);
+        }
+    }
+
+    writer.write(animated.progress);
+    writer.write(animated.speed);
+    writer.write(animated.active_animation);
+    writer.write(animated.active);
+    writer.write(animated.loop);
+}
+
+static Animated load_animated(ecs::SnapshotReader &reader) {
+    Animated animated;
+
+    animated.animations.resize(reader.read<uint64_t>());
+    for (auto &animation : animated.animations) {
+        animation.animation_components.resize(reader.read<uint64_t>());
+        for (auto &component : animation.animation_components) {
+            component.sub_components.resize(reader.read<uint64_t>());
+            for (auto &sub_component : component.sub_components) {
+                sub_component.target_start = load_target(reader);
+                sub_component.target_end = load_target(reader);
+                sub_component.start_time = reader.read<float>();
+                sub_component.end_time = reader.read<float>();
+            }
+            component.target_start = load_target(reader);
+            component.target_progress = load_target(reader);
+            component.current_sub_component = reader.read<uint32_t>();
+            component.node_id = reader.read<uint32_t>();
+            component.type = reader.read<Animated::Animation::Component::Type>();
+            component.interpolation = reader.read<Animated::Animation::Component::Interpolation>();
+        }
+    }
+
+    animated.progress = reader.read<float>();
+    animated.speed = reader.read<float>();
+    animated.active_animation = reader.read<uint16_t>();
+    animated.active = reader.read<bool>();
+    animated.loop = reader.read<bool>();
+    return animated;
+}
+
+AnimationController::AnimationController() {
+    ecs::ComponentStore::get().register_serializer<Animated>(save_animated, load_animated);
+}
+
 void AnimationController::load_animations(uint32_t e_id, const glTFModel &model) {
     if (model.get_animation_count() == 0)
         return;
@@ -92,11 +171,10 @@ void AnimationController::load_animations(uint32_t e_id, const glTFModel &model)
 void AnimationController::update(float time_change) {
     auto &entity_group = boa::ecs::EntityGroup::get();
 
-    entity_group.for_each_entity_with_component<Animated>([&](uint32_t e_id) {
+    entity_group.parallel_for_each_entity_with_component<Animated>([&](uint32_t e_id) {
         auto &animated = entity_group.get_component<Animated>(e_id);
         if (animated.active)
             animated.update(time_change);
-        return Iteration::Continue;
     });
 }
 
@@ -224,12 +302,12 @@ void Animated::update(float time_change) {
     }
 }
 
-glm::mat4 Animated::transform_for_node(size_t node_id) {
+glm::mat4 Animated::transform_for_node(size_t node_id) const {
     if (!active)
         return glm::mat4{ 1.0f };
 
     glm::mat4 ret{ 1.0f };
-    for (auto &component : animations[active_animation].animation_components) {
+    for (const auto &component : animations[active_animation].animation_components) {
         if (node_id == component.node_id) {
             switch (component.type) {
             case Animation::Component::Type::Translation:
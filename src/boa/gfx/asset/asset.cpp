@@ -89,7 +89,9 @@ GPUModel::GPUModel(AssetManager &asset_manager, Renderer &renderer, const glTFMo
         return Iteration::Continue;
     });
 
-    upload_model_vertices(asset_manager, renderer, model);
+    flatten_nodes();
+
+    upload_model_vertices(asset_manager, model);
 
     bounding_box.min = glm::vec3(std::numeric_limits<float>::max());
     bounding_box.max = glm::vec3(std::numeric_limits<float>::min());
@@ -98,7 +100,7 @@ GPUModel::GPUModel(AssetManager &asset_manager, Renderer &renderer, const glTFMo
         return Iteration::Continue;
     });
 
-    upload_bounding_box_vertices(asset_manager, renderer);
+    upload_bounding_box_vertices(asset_manager);
 }
 
 static inline vk::Filter tinygltf_to_vulkan_filter(int gltf) {
@@ -152,6 +154,27 @@ vk::Sampler GPUModel::create_sampler(AssetManager &asset_manager, Renderer &rend
     return new_sampler;
 }
 
+void GPUModel::flatten_nodes() {
+    flat_nodes.clear();
+    drawable_nodes.clear();
+    flat_nodes.reserve(nodes.size());
+
+    for (uint32_t root_idx : root_nodes)
+        flat_nodes.push_back(FlatNode{ root_idx, -1, nodes[root_idx].transform_matrix });
+
+    // breadth first, children are appended after every node before them
+    for (uint32_t i = 0; i < flat_nodes.size(); i++) {
+        const GPUNode &node = nodes[flat_nodes[i].node];
+        if (!node.primitives.empty())
+            drawable_nodes.push_back(i);
+
+        for (uint32_t child_idx : node.children) {
+            glm::mat4 model_transform = flat_nodes[i].model_transform * nodes[child_idx].transform_matrix;
+            flat_nodes.push_back(FlatNode{ child_idx, static_cast<int32_t>(i), model_transform });
+        }
+    }
+}
+
 void GPUModel::calculate_model_bounding_box(const glTFModel &model, const glTFModel::Node &node, glm::mat4 transform_matrix) {
     transform_matrix *= glm::mat4(node.matrix);
 
@@ -263,10 +286,9 @@ void GPUModel::add_from_node(AssetManager &asset_manager, Renderer &renderer, co
                 }
             }
 
-            new_boa_primitive.index_count = primitive.indices.size();
-            new_boa_primitive.bounding_sphere = primitive.bounding_sphere;
+            new_boa_primitive.bounding_box = primitive.bounding_box;
 
-            upload_primitive_indices(asset_manager, renderer, new_boa_primitive, primitive);
+            upload_primitive_indices(asset_manager, new_boa_primitive, primitive);
 
             new_boa_node.primitives.push_back(primitives.size());
             primitives.push_back(std::move(new_boa_primitive));
@@ -670,58 +692,24 @@ GPUTexture::GPUTexture(AssetManager &asset_manager, Renderer &renderer, const st
         stbi_image_free(pixels[i]);
 }
 
-void GPUModel::upload_primitive_indices(AssetManager &asset_manager, Renderer &renderer, GPUPrimitive &vk_primitive, const glTFModel::Primitive &primitive) {
-    const size_t size = primitive.indices.size() * sizeof(uint32_t);
-
-    VmaBuffer staging_buffer = renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_ONLY);
+void GPUModel::upload_primitive_indices(AssetManager &asset_manager, GPUPrimitive &vk_primitive, const glTFModel::Primitive &primitive) {
+    uint32_t first_index = asset_manager.m_index_arena.upload(primitive.indices.data(), primitive.indices.size());
 
-    void *data;
-    vmaMapMemory(renderer.m_allocator, staging_buffer.allocation, &data);
-    memcpy(data, primitive.indices.data(), size);
-    vmaUnmapMemory(renderer.m_allocator, staging_buffer.allocation);
-
-    vk_primitive.index_buffer = renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-        VMA_MEMORY_USAGE_GPU_ONLY);
-
-    renderer.immediate_command([=](vk::CommandBuffer cmd) {
-        vk::BufferCopy copy{ .srcOffset = 0, .dstOffset = 0, .size = size };
-        cmd.copyBuffer(staging_buffer.buffer, vk_primitive.index_buffer.buffer, copy);
-    });
-
-    asset_manager.m_deletion_queue.enqueue([=, &allocator = renderer.m_allocator]() {
-        vmaDestroyBuffer(allocator, vk_primitive.index_buffer.buffer, vk_primitive.index_buffer.allocation);
-    });
-
-    vmaDestroyBuffer(renderer.m_allocator, staging_buffer.buffer, staging_buffer.allocation);
+    vk_primitive.lod_count = static_cast<uint32_t>(primitive.lods.size());
+    for (uint32_t lod = 0; lod < vk_primitive.lod_count; lod++) {
+        vk_primitive.lods[lod] = {
+            .first_index = first_index + primitive.lods[lod].first_index,
+            .index_count = primitive.lods[lod].index_count,
+        };
+    }
 }
 
-void GPUModel::upload_model_vertices(AssetManager &asset_manager, Renderer &renderer, const glTFModel &model) {
-    const size_t size = model.get_vertices().size() * sizeof(Vertex);
-
-    VmaBuffer staging_buffer = renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_ONLY);
-
-    void *data;
-    vmaMapMemory(renderer.m_allocator, staging_buffer.allocation, &data);
-    memcpy(data, model.get_vertices().data(), size);
-    vmaUnmapMemory(renderer.m_allocator, staging_buffer.allocation);
-
-    vertex_buffer = renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-        VMA_MEMORY_USAGE_GPU_ONLY);
-
-    renderer.immediate_command([=](vk::CommandBuffer cmd) {
-        vk::BufferCopy copy{ .srcOffset = 0, .dstOffset = 0, .size = size };
-        cmd.copyBuffer(staging_buffer.buffer, vertex_buffer.buffer, copy);
-    });
-
-    asset_manager.m_deletion_queue.enqueue([copy = vertex_buffer, &allocator = renderer.m_allocator]() {
-        vmaDestroyBuffer(allocator, copy.buffer,
-            copy.allocation);
-    });
-
-    vmaDestroyBuffer(renderer.m_allocator, staging_buffer.buffer, staging_buffer.allocation);
+void GPUModel::upload_model_vertices(AssetManager &asset_manager, const glTFModel &model) {
+    vertex_count = model.get_vertices().size();
+    vertex_offset = asset_manager.m_vertex_arena.upload(model.get_vertices().data(), vertex_count);
 }
 
-void GPUModel::upload_bounding_box_vertices(AssetManager &asset_manager, Renderer &renderer) {
+void GPUModel::upload_bounding_box_vertices(AssetManager &asset_manager) {
     std::array<SmallVertex, 8> bounding_box_vertices{
         SmallVertex{ .position = { bounding_box.min } },
         SmallVertex{ .position = { bounding_box.max } },
@@ -748,29 +736,8 @@ void GPUModel::upload_bounding_box_vertices(AssetManager &asset_manager, Rendere
         bounding_box_vertices[3], bounding_box_vertices[0],
     };
 
-    const size_t size = bounding_box_vertices_repeated.size() * sizeof(SmallVertex);
-
-    VmaBuffer staging_buffer = renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_ONLY);
-
-    void *data;
-    vmaMapMemory(renderer.m_allocator, staging_buffer.allocation, &data);
-    memcpy(data, bounding_box_vertices_repeated.data(), size);
-    vmaUnmapMemory(renderer.m_allocator, staging_buffer.allocation);
-
-    bounding_box_vertex_buffer = renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-        VMA_MEMORY_USAGE_GPU_ONLY);
-
-    renderer.immediate_command([=](vk::CommandBuffer cmd) {
-        vk::BufferCopy copy{ .srcOffset = 0, .dstOffset = 0, .size = size };
-        cmd.copyBuffer(staging_buffer.buffer, bounding_box_vertex_buffer.buffer, copy);
-    });
-
-    asset_manager.m_deletion_queue.enqueue([copy = bounding_box_vertex_buffer, &allocator = renderer.m_allocator]() {
-        vmaDestroyBuffer(allocator, copy.buffer,
-            copy.allocation);
-    });
-
-    vmaDestroyBuffer(renderer.m_allocator, staging_buffer.buffer, staging_buffer.allocation);
+    bounding_box_first_vertex = asset_manager.m_bounding_box_arena.upload(bounding_box_vertices_repeated.data(),
+        bounding_box_vertices_repeated.size());
 }
 
 }
@@ -4,13 +4,17 @@
 #include "boa/gfx/linear.h"
 #include "boa/gfx/asset/asset_manager.h"
 #include "boa/gfx/renderer.h"
+#include <algorithm>
 #include <array>
 #include <filesystem>
 
 namespace boa::gfx {
 
 AssetManager::AssetManager(Renderer &renderer)
-    : m_renderer(renderer)
+    : m_renderer(renderer),
+      m_vertex_arena(renderer, vk::BufferUsageFlagBits::eVertexBuffer, sizeof(Vertex), INITIAL_VERTEX_CAPACITY),
+      m_index_arena(renderer, vk::BufferUsageFlagBits::eIndexBuffer, sizeof(uint32_t), INITIAL_INDEX_CAPACITY),
+      m_bounding_box_arena(renderer, vk::BufferUsageFlagBits::eVertexBuffer, sizeof(SmallVertex), INITIAL_BOUNDING_BOX_VERTEX_CAPACITY)
 {
 }
 
@@ -75,6 +79,13 @@ uint32_t AssetManager::create_material(vk::Pipeline pipeline, vk::PipelineLayout
     GPUMaterial material;
     material.pipeline = pipeline;
     material.pipeline_layout = layout;
+
+    // only a handful of pipelines exist, materials mostly share them
+    auto known_pipeline = std::find(m_pipelines.begin(), m_pipelines.end(), pipeline);
+    material.pipeline_id = known_pipeline - m_pipelines.begin();
+    if (known_pipeline == m_pipelines.end())
+        m_pipelines.push_back(pipeline);
+
     m_materials.push_back(std::move(material));
     return m_materials.size() - 1;
 }
@@ -88,6 +99,9 @@ void AssetManager::reset() {
     m_deletion_queue.flush();
     m_materials.erase(m_materials.begin() + m_renderer.NUMBER_OF_DEFAULT_MATERIALS, m_materials.end());
     m_models.clear();
+    m_vertex_arena.clear();
+    m_index_arena.clear();
+    m_bounding_box_arena.clear();
     //m_models_meta_data.clear();
     //m_entity_resource_paths.clear();
     m_model_path_to_model_index.clear();
@@ -5,6 +5,7 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "boa/utl/macros.h"
 #include "boa/gfx/asset/gltf_model.h"
+#include "boa/gfx/asset/mesh_simplifier.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/quaternion.hpp"
 #include "glm/gtx/transform.hpp"
@@ -402,6 +403,8 @@ void glTFModel::open_gltf_file(const char *path) {
 
                     m_vertices.push_back(std::move(vertex));
                 }
+
+                generate_lods(m_primitives.back());
             }
 
             m_meshes.push_back(std::move(new_mesh));
@@ -423,7 +426,9 @@ void glTFModel::debug_print_node(const Node &node, uint32_t indent) const {
             const auto &primitive = m_primitives.at(primitive_idx);
             if (primitive.material.has_value())
                 LOG_INFO("(glTF){: >{}}        HAS MATERIAL: #{}", "", indent, primitive.material.value());
-            LOG_INFO("(glTF){: >{}}        VERTEX COUNT = {}", "", indent, primitive.indices.size());
+            LOG_INFO("(glTF){: >{}}        VERTEX COUNT = {}", "", indent, primitive.lods[0].index_count);
+            for (size_t lod = 1; lod < primitive.lods.size(); lod++)
+                LOG_INFO("(glTF){: >{}}        LOD {} VERTEX COUNT = {}", "", indent, lod, primitive.lods[lod].index_count);
         }
     }
 
@@ -431,6 +436,33 @@ void glTFModel::debug_print_node(const Node &node, uint32_t indent) const {
         debug_print_node(m_nodes[child_idx], indent + 4);
 }
 
+void glTFModel::generate_lods(Primitive &primitive) const {
+    // smallest primitive worth simplifying and the least it has to shrink by
+    constexpr size_t MIN_LOD_INDICES = 192;
+    constexpr float MIN_LOD_REDUCTION = 0.75f;
+    // allowed error at the first level, doubling at every one after
+    constexpr float LOD_ERROR = 0.01f;
+
+    const uint32_t full_count = static_cast<uint32_t>(primitive.indices.size());
+    primitive.lods.push_back({ 0, full_count });
+
+    // errors are relative to the size of the primitive
+    const float extent = glm::length(primitive.bounding_box.max - primitive.bounding_box.min);
+    std::vector<uint32_t> previous(primitive.indices);
+    float max_error = LOD_ERROR * extent;
+
+    while (primitive.lods.size() < MAX_LODS && previous.size() >= MIN_LOD_INDICES) {
+        std::vector<uint32_t> simplified = simplify_mesh(m_vertices, previous, previous.size() / 2, max_error);
+        if (simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION)
+            break;
+
+        primitive.lods.push_back({ static_cast<uint32_t>(primitive.indices.size()), static_cast<uint32_t>(simplified.size()) });
+        primitive.indices.insert(primitive.indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+        max_error *= 2.0f;
+    }
+}
+
 void glTFModel::debug_print() const {
     LOG_INFO("(glTF) Size of nodes: {}", m_nodes.size());
     for (size_t node_idx : m_root_nodes)
@@ -0,0 +1,92 @@
+#include "boa/gfx/asset/mesh_arena.h"
+#include "boa/gfx/renderer.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace boa::gfx {
+
+MeshArena::MeshArena(Renderer &renderer, vk::BufferUsageFlags usage, uint32_t element_size, uint32_t initial_capacity)
+    : m_renderer(renderer),
+      m_usage(usage),
+      m_element_size(element_size),
+      m_initial_capacity(initial_capacity)
+{
+}
+
+uint32_t MeshArena::upload(const void *elements, uint32_t count) {
+    if (count == 0)
+        return 0;
+
+    std::optional<uint32_t> first = m_ranges.allocate(count);
+    if (!first.has_value()) {
+        grow(m_ranges.capacity() + count);
+        first = m_ranges.allocate(count);
+        if (!first.has_value())
+            throw std::runtime_error("Failed to allocate from mesh arena");
+    }
+
+    const size_t offset = static_cast<size_t>(first.value()) * m_element_size;
+    const size_t size = static_cast<size_t>(count) * m_element_size;
+
+    VmaBuffer staging_buffer = m_renderer.create_buffer(size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_ONLY);
+
+    void *data;
+    vmaMapMemory(m_renderer.m_allocator, staging_buffer.allocation, &data);
+    memcpy(data, elements, size);
+    vmaUnmapMemory(m_renderer.m_allocator, staging_buffer.allocation);
+
+    m_renderer.immediate_command([=, buffer = m_buffer.buffer](vk::CommandBuffer cmd) {
+        vk::BufferCopy copy{ .srcOffset = 0, .dstOffset = offset, .size = size };
+        cmd.copyBuffer(staging_buffer.buffer, buffer, copy);
+    });
+
+    vmaDestroyBuffer(m_renderer.m_allocator, staging_buffer.buffer, staging_buffer.allocation);
+
+    return first.value();
+}
+
+void MeshArena::free(uint32_t first, uint32_t count) {
+    m_ranges.free(first, count);
+}
+
+void MeshArena::clear() {
+    m_ranges.clear();
+}
+
+void MeshArena::grow(uint32_t min_capacity) {
+    uint32_t old_capacity = m_ranges.capacity();
+    uint64_t new_capacity = std::max<uint64_t>(m_initial_capacity, old_capacity);
+    while (new_capacity < min_capacity)
+        new_capacity *= 2;
+
+    if (new_capacity * m_element_size > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Mesh arena outgrew 4 GiB");
+
+    LOG_INFO("(Asset) Growing mesh arena to {} elements", new_capacity);
+
+    VmaBuffer new_buffer = m_renderer.create_buffer(new_capacity * m_element_size,
+        m_usage | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_GPU_ONLY);
+
+    if ((VkBuffer)m_buffer.buffer != VK_NULL_HANDLE) {
+        // ranges keep their offsets, so the old contents move over as they are
+        m_renderer.immediate_command([=, old_buffer = m_buffer.buffer](vk::CommandBuffer cmd) {
+            vk::BufferCopy copy{ .srcOffset = 0, .dstOffset = 0, .size = static_cast<vk::DeviceSize>(old_capacity) * m_element_size };
+            cmd.copyBuffer(old_buffer, new_buffer.buffer, copy);
+        });
+
+        // frames in flight may still read the old buffer
+        m_renderer.wait_idle();
+        vmaDestroyBuffer(m_renderer.m_allocator, m_buffer.buffer, m_buffer.allocation);
+    } else {
+        m_renderer.m_deletion_queue.enqueue([this]() {
+            vmaDestroyBuffer(m_renderer.m_allocator, m_buffer.buffer, m_buffer.allocation);
+            m_buffer = VmaBuffer{};
+        });
+    }
+
+    m_buffer = new_buffer;
+    m_ranges.grow(new_capacity);
+}
+
+}
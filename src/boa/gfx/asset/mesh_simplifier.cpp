@@ -0,0 +1,290 @@
+#include "boa/gfx/asset/mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
+
+namespace boa::gfx {
+
+namespace {
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix
+// of Garland and Heckbert with its upper triangle stored row by row.
+// Planes are weighted by the area of their triangle, `weight` sums those
+// so error() can be turned back into a distance.
+struct Quadric {
+    double a00{ 0 }, a01{ 0 }, a02{ 0 }, a03{ 0 };
+    double a11{ 0 }, a12{ 0 }, a13{ 0 };
+    double a22{ 0 }, a23{ 0 };
+    double a33{ 0 };
+    double weight{ 0 };
+
+    void add_plane(const glm::vec3 &normal, float distance, float area) {
+        const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        a00 += area * a * a; a01 += area * a * b; a02 += area * a * c; a03 += area * a * d;
+        a11 += area * b * b; a12 += area * b * c; a13 += area * b * d;
+        a22 += area * c * c; a23 += area * c * d;
+        a33 += area * d * d;
+        weight += area;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+        return *this;
+    }
+
+    // mean squared distance of `p` to the planes
+    double error(const glm::vec3 &p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        double sum = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                   + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                   + a22 * z * z + 2 * a23 * z
+                   + a33;
+        return weight > 0 ? std::max(sum, 0.0) / weight : 0.0;
+    }
+};
+
+struct PositionHash {
+    size_t operator()(const glm::vec3 &p) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+struct Collapse {
+    uint32_t from, to;
+    double error;
+};
+
+}
+
+std::vector<uint32_t> simplify_mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+        size_t target_index_count, float max_error) {
+    std::vector<uint32_t> result(indices);
+    if (indices.size() < 3 || indices.size() <= target_index_count)
+        return result;
+
+    // primitives index a range of the model's vertices, work within it
+    const auto [min_it, max_it] = std::minmax_element(indices.begin(), indices.end());
+    const uint32_t first_vertex = *min_it;
+    const uint32_t vertex_count = *max_it - first_vertex + 1;
+    for (uint32_t &index : result)
+        index -= first_vertex;
+
+    const auto position = [&](uint32_t v) -> const glm::vec3 & {
+        return vertices[first_vertex + v].position;
+    };
+
+    // vertices sharing a position share a quadric through the first of them
+    std::vector<uint32_t> position_of(vertex_count);
+    std::vector<uint32_t> wedge_count(vertex_count, 0);
+    {
+        std::unordered_map<glm::vec3, uint32_t, PositionHash> first_with_position;
+        first_with_position.reserve(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            position_of[v] = first_with_position.emplace(position(v), v).first->second;
+            wedge_count[position_of[v]]++;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertex_count);
+    // a seam vertex has more than one wedge, a border edge only one triangle
+    std::vector<uint8_t> locked(vertex_count, 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> edge_uses;
+        edge_uses.reserve(result.size());
+
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t corners[3] = { position_of[result[i]], position_of[result[i + 1]], position_of[result[i + 2]] };
+            glm::vec3 normal = glm::cross(position(corners[1]) - position(corners[0]), position(corners[2]) - position(corners[0]));
+            float length = glm::length(normal);
+
+            if (length > 0.0f) {
+                normal /= length;
+                for (uint32_t corner : corners)
+                    quadrics[corner].add_plane(normal, -glm::dot(normal, position(corners[0])), length * 0.5f);
+            }
+
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t a = corners[k], b = corners[(k + 1) % 3];
+                edge_uses[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+            }
+        }
+
+        for (const auto &[edge, uses] : edge_uses) {
+            if (uses != 2) {
+                locked[edge >> 32] = 1;
+                locked[static_cast<uint32_t>(edge)] = 1;
+            }
+        }
+
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            if (wedge_count[position_of[v]] > 1)
+                locked[position_of[v]] = 1;
+        }
+    }
+
+    const double max_error_squared = double(max_error) * max_error;
+
+    constexpr double NO_COLLAPSE = std::numeric_limits<double>::max();
+
+    std::vector<uint32_t> fan_offsets(vertex_count + 1);
+    std::vector<uint32_t> fan_fill(vertex_count);
+    std::vector<uint32_t> fans;
+    std::vector<Collapse> best(vertex_count);
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(vertex_count);
+    std::vector<uint32_t> from_neighbours, to_neighbours, common_neighbours;
+
+    // Each pass collapses the cheapest edges first, at most one per
+    // position, then drops the triangles that were squashed flat.
+    while (result.size() > target_index_count) {
+        // triangles around every position, counted then filled in place
+        std::fill(fan_offsets.begin(), fan_offsets.end(), 0);
+        for (uint32_t index : result)
+            fan_offsets[position_of[index] + 1]++;
+        for (uint32_t v = 0; v < vertex_count; v++)
+            fan_offsets[v + 1] += fan_offsets[v];
+
+        fans.resize(result.size());
+        std::copy(fan_offsets.begin(), fan_offsets.end() - 1, fan_fill.begin());
+        for (uint32_t i = 0; i < result.size(); i++)
+            fans[fan_fill[position_of[result[i]]]++] = i / 3;
+
+        // the cheapest neighbour to move each free vertex onto
+        std::fill(best.begin(), best.end(), Collapse{ 0, 0, NO_COLLAPSE });
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t from = result[i + k];
+                if (locked[position_of[from]])
+                    continue;
+
+                for (uint32_t to : { result[i + (k + 1) % 3], result[i + (k + 2) % 3] }) {
+                    double error = quadrics[position_of[from]].error(position(to));
+                    if (error < best[from].error)
+                        best[from] = Collapse{ from, to, error };
+                }
+            }
+        }
+
+        collapses.clear();
+        for (const Collapse &collapse : best) {
+            if (collapse.error != NO_COLLAPSE && collapse.error <= max_error_squared)
+                collapses.push_back(collapse);
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.error < b.error;
+        });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t triangle_count = result.size() / 3;
+        const size_t target_triangle_count = target_index_count / 3;
+        bool collapsed = false;
+
+        for (const Collapse &collapse : collapses) {
+            if (triangle_count <= target_triangle_count)
+                break;
+
+            const uint32_t from_position = position_of[collapse.from];
+            const uint32_t to_position = position_of[collapse.to];
+            if (touched[from_position] || touched[to_position])
+                continue;
+
+            // triangles that keep their area must not turn over, or tip so
+            // far that a sliver could end up facing the other way
+            bool flips = false;
+            uint32_t squashed = 0;
+            for (uint32_t f = fan_offsets[from_position]; f < fan_offsets[from_position + 1] && !flips; f++) {
+                const uint32_t *triangle = &result[fans[f] * 3];
+                glm::vec3 before[3], after[3];
+                bool has_to = false;
+                for (uint32_t k = 0; k < 3; k++) {
+                    has_to |= position_of[triangle[k]] == to_position;
+                    before[k] = position(triangle[k]);
+                    after[k] = triangle[k] == collapse.from ? position(collapse.to) : before[k];
+                }
+
+                if (has_to) {
+                    squashed++;
+                    continue;
+                }
+
+                // already flat ones can't flip
+                glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+                float lengths = glm::length(normal_before) * glm::length(normal_after);
+                flips = lengths > 0.0f && glm::dot(normal_before, normal_after) < 0.25f * lengths;
+            }
+
+            if (flips)
+                continue;
+
+            // Neighbours of both ends other than the third corners of the
+            // squashed triangles would be left with a folded pair of
+            // triangles, the link condition of Dey et al.
+            const auto collect_neighbours = [&](uint32_t around, std::vector<uint32_t> &neighbours) {
+                neighbours.clear();
+                for (uint32_t f = fan_offsets[around]; f < fan_offsets[around + 1]; f++) {
+                    for (uint32_t k = 0; k < 3; k++) {
+                        uint32_t neighbour = position_of[result[fans[f] * 3 + k]];
+                        if (neighbour != around)
+                            neighbours.push_back(neighbour);
+                    }
+                }
+                std::sort(neighbours.begin(), neighbours.end());
+                neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            };
+
+            collect_neighbours(from_position, from_neighbours);
+            collect_neighbours(to_position, to_neighbours);
+            common_neighbours.clear();
+            std::set_intersection(from_neighbours.begin(), from_neighbours.end(), to_neighbours.begin(), to_neighbours.end(),
+                std::back_inserter(common_neighbours));
+            if (common_neighbours.size() > squashed)
+                continue;
+
+            for (uint32_t f = fan_offsets[from_position]; f < fan_offsets[from_position + 1]; f++) {
+                uint32_t *triangle = &result[fans[f] * 3];
+                for (uint32_t k = 0; k < 3; k++) {
+                    if (triangle[k] == collapse.from)
+                        triangle[k] = collapse.to;
+                }
+            }
+
+            quadrics[to_position] += quadrics[from_position];
+            touched[from_position] = 1;
+            touched[to_position] = 1;
+            triangle_count -= std::min<size_t>(squashed, triangle_count);
+            collapsed = true;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = position_of[result[i]], b = position_of[result[i + 1]], c = position_of[result[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+
+            result[kept++] = result[i];
+            result[kept++] = result[i + 1];
+            result[kept++] = result[i + 2];
+        }
+        result.resize(kept);
+
+        if (!collapsed)
+            break;
+    }
+
+    for (uint32_t &index : result)
+        index += first_vertex;
+    return result;
+}
+
+}
@@ -0,0 +1,110 @@
+#include "boa/gfx/culling.h"
+#include <cmath>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace boa::gfx {
+
+void BoxBatch::clear() {
+    m_center_x.clear();
+    m_center_y.clear();
+    m_center_z.clear();
+    m_extent_x.clear();
+    m_extent_y.clear();
+    m_extent_z.clear();
+}
+
+void BoxBatch::reserve(size_t count) {
+    m_center_x.reserve(count);
+    m_center_y.reserve(count);
+    m_center_z.reserve(count);
+    m_extent_x.reserve(count);
+    m_extent_y.reserve(count);
+    m_extent_z.reserve(count);
+}
+
+void BoxBatch::push_back(const Box &box) {
+    m_center_x.push_back((box.min.x + box.max.x) * 0.5f);
+    m_center_y.push_back((box.min.y + box.max.y) * 0.5f);
+    m_center_z.push_back((box.min.z + box.max.z) * 0.5f);
+    m_extent_x.push_back((box.max.x - box.min.x) * 0.5f);
+    m_extent_y.push_back((box.max.y - box.min.y) * 0.5f);
+    m_extent_z.push_back((box.max.z - box.min.z) * 0.5f);
+}
+
+// A box is outside when its center is further behind some plane than the
+// box reaches towards it, the reach being its extents projected onto the
+// absolute plane normal. Same test as Frustum::is_box_within.
+void BoxBatch::cull(const Frustum &frustum, std::vector<uint8_t> &visible) const {
+    const size_t count = size();
+    visible.resize(count);
+
+    size_t i = 0;
+
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8) {
+        __m256 center_x = _mm256_loadu_ps(&m_center_x[i]);
+        __m256 center_y = _mm256_loadu_ps(&m_center_y[i]);
+        __m256 center_z = _mm256_loadu_ps(&m_center_z[i]);
+        __m256 extent_x = _mm256_loadu_ps(&m_extent_x[i]);
+        __m256 extent_y = _mm256_loadu_ps(&m_extent_y[i]);
+        __m256 extent_z = _mm256_loadu_ps(&m_extent_z[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto &plane : frustum.planes) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(center_x, _mm256_set1_ps(plane.x)),
+                                                          _mm256_mul_ps(center_y, _mm256_set1_ps(plane.y))),
+                                            _mm256_add_ps(_mm256_mul_ps(center_z, _mm256_set1_ps(plane.z)),
+                                                          _mm256_set1_ps(plane.w)));
+            __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(extent_x, _mm256_set1_ps(std::abs(plane.x))),
+                                                       _mm256_mul_ps(extent_y, _mm256_set1_ps(std::abs(plane.y)))),
+                                         _mm256_mul_ps(extent_z, _mm256_set1_ps(std::abs(plane.z))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GT_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (size_t lane = 0; lane < 8; lane++)
+            visible[i + lane] = (mask >> lane) & 1;
+    }
+#endif
+
+#if defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        __m128 center_x = _mm_loadu_ps(&m_center_x[i]);
+        __m128 center_y = _mm_loadu_ps(&m_center_y[i]);
+        __m128 center_z = _mm_loadu_ps(&m_center_z[i]);
+        __m128 extent_x = _mm_loadu_ps(&m_extent_x[i]);
+        __m128 extent_y = _mm_loadu_ps(&m_extent_y[i]);
+        __m128 extent_z = _mm_loadu_ps(&m_extent_z[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto &plane : frustum.planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(plane.x)),
+                                                    _mm_mul_ps(center_y, _mm_set1_ps(plane.y))),
+                                         _mm_add_ps(_mm_mul_ps(center_z, _mm_set1_ps(plane.z)),
+                                                    _mm_set1_ps(plane.w)));
+            __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extent_x, _mm_set1_ps(std::abs(plane.x))),
+                                                 _mm_mul_ps(extent_y, _mm_set1_ps(std::abs(plane.y)))),
+                                      _mm_mul_ps(extent_z, _mm_set1_ps(std::abs(plane.z))));
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (size_t lane = 0; lane < 4; lane++)
+            visible[i + lane] = (mask >> lane) & 1;
+    }
+#endif
+
+    for (; i < count; i++) {
+        bool inside = true;
+        for (const auto &plane : frustum.planes) {
+            float distance = plane.x * m_center_x[i] + plane.y * m_center_y[i] + plane.z * m_center_z[i] + plane.w;
+            float reach = std::abs(plane.x) * m_extent_x[i] + std::abs(plane.y) * m_extent_y[i] + std::abs(plane.z) * m_extent_z[i];
+            inside &= distance + reach > 0.0f;
+        }
+        visible[i] = inside;
+    }
+}
+
+}
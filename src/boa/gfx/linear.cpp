@@ -1,5 +1,7 @@
 #include "boa/utl/macros.h"
 #include "boa/gfx/linear.h"
+#include "boa/utl/thread_pool.h"
+#include "boa/ecs/entity.h"
 #include "glm/gtx/quaternion.hpp"
 #include "glm/gtx/transform.hpp"
 #include "glm/gtx/matrix_decompose.hpp"
@@ -7,18 +9,102 @@
 namespace boa::gfx {
 
 void Transformable::update() {
+    Ref{ transform_matrix, orientation, translation, scale }.update();
+}
+
+void Transformable::decompose() {
+    Ref{ transform_matrix, orientation, translation, scale }.decompose();
+}
+
+void Transformable::Ref::update() {
     transform_matrix = glm::mat4(1.0f);
     transform_matrix *= glm::translate(translation);
     transform_matrix *= glm::toMat4(orientation);
     transform_matrix *= glm::scale(scale);
 }
 
-void Transformable::decompose() {
+void Transformable::Ref::decompose() {
     glm::vec3 skew;
     glm::vec4 perspective;
     glm::decompose(transform_matrix, scale, orientation, translation, skew, perspective);
 }
 
+// translate(t) * toMat4(q) * scale(s) written out, with no branches or
+// calls so the compiler can run it across a batch in vector registers
+static inline void compose(glm::mat4 &m, const glm::quat &q, const glm::vec3 &t, const glm::vec3 &s) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    m[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * s.x;
+    m[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * s.y;
+    m[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * s.z;
+    m[3] = glm::vec4(t, 1.0f);
+}
+
+static void compose_batch(glm::mat4 *matrices, const glm::quat *orientations,
+                          const glm::vec3 *translations, const glm::vec3 *scales) {
+    for (uint32_t i = 0; i < TRANSFORM_BATCH_SIZE; i++)
+        compose(matrices[i], orientations[i], translations[i], scales[i]);
+}
+
+void Transformable::update_changed(ecs::SoaComponentPool<Transformable> &pool, uint32_t since_version) {
+    static_assert(ecs::COMPONENT_PAGE_CAPACITY % TRANSFORM_BATCH_SIZE == 0);
+
+    const std::vector<uint32_t> &versions = pool.versions();
+    const size_t slot_count = versions.size();
+
+    ThreadPool::get().parallel_for(pool.page_count(), 1, [&](size_t begin, size_t end) {
+        for (size_t page = begin; page < end; page++) {
+            glm::mat4 *matrices = pool.field_data<0>(page);
+            const glm::quat *orientations = pool.field_data<1>(page);
+            const glm::vec3 *translations = pool.field_data<2>(page);
+            const glm::vec3 *scales = pool.field_data<3>(page);
+
+            const size_t page_begin = page * ecs::COMPONENT_PAGE_CAPACITY;
+            const size_t page_end = std::min<size_t>(page_begin + ecs::COMPONENT_PAGE_CAPACITY, slot_count);
+
+            // a whole batch is recomposed when any of its slots changed;
+            // unchanged neighbours and holes just get the matrix they had
+            for (size_t batch = page_begin; batch < page_end; batch += TRANSFORM_BATCH_SIZE) {
+                bool changed = false;
+                for (size_t slot = batch; slot < std::min<size_t>(batch + TRANSFORM_BATCH_SIZE, page_end); slot++)
+                    changed |= versions[slot] > since_version;
+                if (!changed)
+                    continue;
+
+                size_t offset = batch - page_begin;
+                compose_batch(matrices + offset, orientations + offset, translations + offset, scales + offset);
+
+                // neighbours got their local matrix back, which matters to children
+                for (size_t slot = batch; slot < std::min<size_t>(batch + TRANSFORM_BATCH_SIZE, page_end); slot++)
+                    pool.mark_slot_changed(slot);
+            }
+        }
+    });
+}
+
+void Transformable::update_hierarchy(ecs::EntityGroup &entity_group, uint32_t since_version) {
+    const auto &pool = ecs::ComponentStore::get().get_pool<Transformable>();
+    const ecs::EntityGroup &reader = entity_group;
+
+    // parents come before their children, so a recomputed parent is already
+    // stamped when its children are checked
+    for (const auto &link : entity_group.hierarchy_order()) {
+        if (!entity_group.has_component<Transformable>(link.e_id) || !entity_group.has_component<Transformable>(link.parent_e_id))
+            continue;
+        if (pool.changed_version(link.e_id) <= since_version && pool.changed_version(link.parent_e_id) <= since_version)
+            continue;
+
+        auto parent = reader.get_component<Transformable>(link.parent_e_id);
+        auto child = entity_group.get_component<Transformable>(link.e_id);
+
+        glm::mat4 local;
+        compose(local, child.orientation, child.translation, child.scale);
+        child.transform_matrix = parent.transform_matrix * local;
+    }
+}
+
 glm::vec3 Box::center() const {
     return glm::vec3{
         (min.x + max.x) / 2,
@@ -33,29 +119,24 @@ void Box::center_on_origin() {
     max = max - box_center;
 }
 
+// Arvo's method: the center is transformed as a point and each new half
+// extent is the old extents dotted with the absolute values of a row of the
+// upper 3x3, which bounds all eight transformed corners without making them.
 void Box::transform(const glm::mat4 &transform) {
-    std::array<glm::vec3, 8> vertices = {
-        min,
-        max,
-        glm::vec3{ min.x, min.y, max.z },
-        glm::vec3{ min.x, max.y, min.z },
-        glm::vec3{ max.x, min.y, min.z },
-        glm::vec3{ min.x, max.y, max.z },
-        glm::vec3{ max.x, min.y, max.z },
-        glm::vec3{ max.x, max.y, min.z },
-    };
+    glm::vec3 box_center = center();
+    glm::vec3 extent = (max - min) * 0.5f;
 
-    for (auto &vertex : vertices)
-        vertex = transform * glm::vec4(vertex, 1.0f);
+    glm::mat3 abs_basis{
+        glm::abs(glm::vec3(transform[0])),
+        glm::abs(glm::vec3(transform[1])),
+        glm::abs(glm::vec3(transform[2])),
+    };
 
-    glm::vec3 new_min, new_max;
-    for (auto &vertex : vertices) {
-        new_min = glm::min(vertex, new_min);
-        new_max = glm::max(vertex, new_max);
-    }
+    glm::vec3 new_center = transform * glm::vec4(box_center, 1.0f);
+    glm::vec3 new_extent = abs_basis * extent;
 
-    min = std::move(new_min);
-    max = std::move(new_max);
+    min = new_center - new_extent;
+    max = new_center + new_extent;
 }
 
 Sphere Sphere::bounding_sphere_from_bounding_box(const Box &box) {
@@ -122,7 +203,17 @@ void Frustum::update(glm::mat4 projection) {
 }
 
 bool Frustum::is_box_within(const Box &box) const {
-    TODO();
+    glm::vec3 center = box.center();
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+
+    // outside when the center is further behind a plane than the box reaches
+    for (const auto &plane : planes) {
+        float reach = glm::dot(glm::abs(glm::vec3(plane)), extent);
+        if (glm::dot(glm::vec3(plane), center) + plane.w <= -reach)
+            return false;
+    }
+
+    return true;
 }
 
 bool Frustum::is_sphere_within(const glm::vec3 &center, float radius) const {
@@ -0,0 +1,158 @@
+#include "boa/gfx/render_queue.h"
+#include <algorithm>
+#include <cstring>
+
+namespace boa::gfx {
+
+namespace sort_key {
+
+uint64_t make(DrawPass pass, uint32_t pipeline, uint32_t descriptor_set, uint32_t material, uint32_t depth_bucket) {
+    const auto field = [](uint64_t value, uint32_t bits) {
+        return value & ((uint64_t(1) << bits) - 1);
+    };
+
+    uint64_t key = field(static_cast<uint32_t>(pass), PASS_BITS);
+    key = (key << PIPELINE_BITS) | field(pipeline, PIPELINE_BITS);
+    key = (key << DESCRIPTOR_BITS) | field(descriptor_set, DESCRIPTOR_BITS);
+    key = (key << MATERIAL_BITS) | field(material, MATERIAL_BITS);
+    key = (key << DEPTH_BITS) | field(depth_bucket, DEPTH_BITS);
+    return key;
+}
+
+uint32_t depth_bucket(float distance, float far) {
+    constexpr uint32_t MAX_BUCKET = (1u << DEPTH_BITS) - 1;
+    float normalized = std::clamp(distance / far, 0.0f, 1.0f);
+    return static_cast<uint32_t>(normalized * MAX_BUCKET);
+}
+
+}
+
+RenderStatistics &RenderStatistics::operator+=(const RenderStatistics &other) {
+    pipeline_binds += other.pipeline_binds;
+    descriptor_binds += other.descriptor_binds;
+    vertex_buffer_binds += other.vertex_buffer_binds;
+    index_buffer_binds += other.index_buffer_binds;
+    push_constants += other.push_constants;
+    draw_calls += other.draw_calls;
+    draws += other.draws;
+    command_buffers += other.command_buffers;
+    triangles += other.triangles;
+    full_detail_triangles += other.full_detail_triangles;
+    return *this;
+}
+
+CommandEmitter::CommandEmitter(vk::CommandBuffer cmd)
+    : m_cmd(cmd)
+{
+}
+
+void CommandEmitter::bind_pipeline(vk::Pipeline pipeline) {
+    m_statistics.pipeline_binds.requested++;
+    if (pipeline == m_pipeline)
+        return;
+
+    m_cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    m_pipeline = pipeline;
+    m_statistics.pipeline_binds.issued++;
+}
+
+bool CommandEmitter::BoundSet::matches(vk::PipelineLayout other_layout, vk::DescriptorSet other_set,
+        vk::ArrayProxy<const uint32_t> offsets) const {
+    return layout == other_layout && set == other_set && dynamic_offset_count == offsets.size() &&
+        std::equal(offsets.begin(), offsets.end(), dynamic_offsets.begin());
+}
+
+void CommandEmitter::bind_descriptor_set(vk::PipelineLayout layout, uint32_t set, vk::DescriptorSet descriptor_set,
+        vk::ArrayProxy<const uint32_t> dynamic_offsets) {
+    m_statistics.descriptor_binds.requested++;
+    if (set < MAX_TRACKED_SETS && m_sets[set].matches(layout, descriptor_set, dynamic_offsets))
+        return;
+
+    m_cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, set, descriptor_set, dynamic_offsets);
+    m_statistics.descriptor_binds.issued++;
+
+    // a bind through another layout may disturb the other sets, so only
+    // trust the ones that were bound through this one
+    for (BoundSet &bound : m_sets) {
+        if (bound.layout != layout)
+            bound = BoundSet{};
+    }
+
+    // sets with more dynamic offsets than tracked are rebound every time
+    if (set < MAX_TRACKED_SETS && dynamic_offsets.size() <= MAX_DYNAMIC_OFFSETS) {
+        BoundSet &bound = m_sets[set];
+        bound.layout = layout;
+        bound.set = descriptor_set;
+        bound.dynamic_offset_count = dynamic_offsets.size();
+        std::copy(dynamic_offsets.begin(), dynamic_offsets.end(), bound.dynamic_offsets.begin());
+    } else if (set < MAX_TRACKED_SETS) {
+        m_sets[set] = BoundSet{};
+    }
+}
+
+void CommandEmitter::bind_vertex_buffer(vk::Buffer buffer) {
+    m_statistics.vertex_buffer_binds.requested++;
+    if (buffer == m_vertex_buffer)
+        return;
+
+    vk::DeviceSize offset = 0;
+    m_cmd.bindVertexBuffers(0, 1, &buffer, &offset);
+    m_vertex_buffer = buffer;
+    m_statistics.vertex_buffer_binds.issued++;
+}
+
+void CommandEmitter::bind_index_buffer(vk::Buffer buffer) {
+    m_statistics.index_buffer_binds.requested++;
+    if (buffer == m_index_buffer)
+        return;
+
+    m_cmd.bindIndexBuffer(buffer, 0, vk::IndexType::eUint32);
+    m_index_buffer = buffer;
+    m_statistics.index_buffer_binds.issued++;
+}
+
+void CommandEmitter::push_constants(vk::PipelineLayout layout, vk::ShaderStageFlags stages, uint32_t size, const void *data) {
+    m_statistics.push_constants.requested++;
+    if (layout == m_push_constants_layout && size == m_push_constants_size &&
+            std::memcmp(m_push_constants.data(), data, size) == 0)
+        return;
+
+    m_cmd.pushConstants(layout, stages, 0, size, data);
+    m_statistics.push_constants.issued++;
+
+    if (size <= MAX_PUSH_CONSTANTS_SIZE) {
+        m_push_constants_layout = layout;
+        m_push_constants_size = size;
+        std::memcpy(m_push_constants.data(), data, size);
+    } else {
+        m_push_constants_layout = vk::PipelineLayout{};
+    }
+}
+
+void CommandEmitter::draw_indexed_indirect(vk::Buffer buffer, vk::DeviceSize offset, uint32_t draw_count, uint32_t stride) {
+    m_cmd.drawIndexedIndirect(buffer, offset, draw_count, stride);
+    m_statistics.draw_calls++;
+    m_statistics.draws += draw_count;
+}
+
+void CommandEmitter::draw_indexed(uint32_t index_count) {
+    m_cmd.drawIndexed(index_count, 1, 0, 0, 0);
+    m_statistics.draw_calls++;
+    m_statistics.draws++;
+}
+
+void CommandEmitter::draw(uint32_t vertex_count, uint32_t first_vertex) {
+    m_cmd.draw(vertex_count, 1, first_vertex, 0);
+    m_statistics.draw_calls++;
+    m_statistics.draws++;
+}
+
+void CommandEmitter::invalidate() {
+    m_pipeline = vk::Pipeline{};
+    m_sets.fill(BoundSet{});
+    m_vertex_buffer = vk::Buffer{};
+    m_index_buffer = vk::Buffer{};
+    m_push_constants_layout = vk::PipelineLayout{};
+}
+
+}
@@ -1,5 +1,7 @@
 #define VMA_IMPLEMENTATION
 #include "boa/utl/iteration.h"
+#include "boa/utl/radix_sort.h"
+#include "boa/utl/thread_pool.h"
 #include "boa/ecs/ecs.h"
 #include "boa/gfx/renderer.h"
 #include "boa/gfx/asset/animation.h"
@@ -11,6 +13,9 @@
 #include "imgui.h"
 #include "GLFW/glfw3.h"
 #include <set>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 #include <unordered_map>
 #include <fstream>
 #include <chrono>
@@ -53,6 +58,7 @@ Renderer::Renderer()
     create_sync_objects();
     create_descriptors();
     create_pipelines();
+    create_depth_pyramid();
     create_skybox_resources();
     init_imgui();
 
@@ -157,6 +163,11 @@ void Renderer::draw_frame() {
 
     frame_cmd.reset();
 
+    for (RecordContext &context : current_frame().record_contexts) {
+        m_device.get().resetCommandPool(context.command_pool);
+        context.used = 0;
+    }
+
     vk::CommandBufferBeginInfo begin_info{
         .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
     };
@@ -196,28 +207,12 @@ void Renderer::draw_frame() {
         .pClearValues       = clear_values.data(),
     };
 
-    // START DRAW COMMANDS
-    frame_cmd.beginRenderPass(render_pass_info, vk::SubpassContents::eInline);
-
-    vk::Viewport viewport{
-        .x          = 0.0f,
-        .y          = 0.0f,
-        .width      = (float)m_window_extent.width,
-        .height     = (float)m_window_extent.height,
-        .minDepth   = 0.0f,
-        .maxDepth   = 1.0f,
-    };
-
-    vk::Rect2D scissor{
-        .offset = { .x = 0, .y = 0 },
-        .extent = m_window_extent,
-    };
+    prepare_renderables(frame_cmd);
 
-    frame_cmd.setViewport(0, viewport);
-    frame_cmd.setScissor(0, scissor);
+    // START DRAW COMMANDS
+    frame_cmd.beginRenderPass(render_pass_info, vk::SubpassContents::eSecondaryCommandBuffers);
 
     draw_renderables(frame_cmd);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame_cmd);
 
     // END DRAW COMMANDS
     frame_cmd.endRenderPass();
@@ -246,6 +241,9 @@ void Renderer::draw_frame() {
         throw std::runtime_error("Failed to submit to graphics queue");
     }
 
+    // the depth image now holds a frame to build the next pyramid from
+    m_depth_pyramid_ready = true;
+
     vk::PresentInfoKHR present_info{
         .waitSemaphoreCount = 1,
         .pWaitSemaphores = &current_frame().render_sem,
@@ -307,7 +305,334 @@ static const std::array<uint32_t, 36> skybox_indices = {
     20, 21, 22, 22, 23, 20,
 };
 
-void Renderer::draw_renderables(vk::CommandBuffer cmd) {
+void Renderer::update_render_bounds() {
+    auto &entity_group = ecs::EntityGroup::get();
+    const auto &const_entity_group = entity_group;
+
+    const auto refresh_bounds = [&](uint32_t e_id) {
+        const auto &model = m_asset_manager.get_model(const_entity_group.get_component<Renderable>(e_id).model_id);
+
+        glm::mat4 entity_transform_matrix{ 1.0f };
+        if (entity_group.has_component<Transformable>(e_id))
+            entity_transform_matrix = const_entity_group.get_component<Transformable>(e_id).transform_matrix;
+
+        Box transform_bounding_box = model.bounding_box;
+        transform_bounding_box.transform(entity_transform_matrix);
+
+        // a restored snapshot can hand back a proxy that is now someone else's
+        uint32_t proxy = SceneIndex::NO_PROXY;
+        if (entity_group.has_component<RenderBounds>(e_id))
+            proxy = const_entity_group.get_component<RenderBounds>(e_id).scene_proxy;
+
+        if (m_scene_index.contains(proxy, e_id)) {
+            m_scene_index.move(proxy, transform_bounding_box);
+        } else {
+            proxy = m_scene_index.insert(e_id, transform_bounding_box);
+            // levels of detail picked for whoever had the proxy before
+            if (proxy < m_proxy_lods.size())
+                m_proxy_lods[proxy].clear();
+        }
+
+        entity_group.enable_and_make<RenderBounds>(e_id, transform_bounding_box, proxy);
+        return Iteration::Continue;
+    };
+
+    // new renderables count as changed, so this also covers first sight
+    entity_group.for_each_changed_entity<Renderable>(m_render_bounds_version, refresh_bounds);
+    entity_group.for_each_changed_entity<Transformable, Renderable>(m_render_bounds_version, refresh_bounds);
+
+    // every renderable has exactly one leaf now, so more leaves than
+    // renderables means some were deleted or stopped being renderable
+    if (m_scene_index.size() > entity_group.view<Renderable>().size()) {
+        m_stale_proxies.clear();
+        m_scene_index.for_each_leaf([&](uint32_t proxy, uint32_t e_id) {
+            if (!entity_group.has_component<Renderable>(e_id) || !entity_group.has_component<RenderBounds>(e_id) ||
+                    const_entity_group.get_component<RenderBounds>(e_id).scene_proxy != proxy)
+                m_stale_proxies.push_back(proxy);
+        });
+
+        for (uint32_t proxy : m_stale_proxies)
+            m_scene_index.remove(proxy);
+    }
+
+    m_scene_index.rebuild_if_degraded();
+
+    m_render_bounds_version = ecs::ComponentStore::get().advance_version();
+}
+
+std::optional<uint32_t> Renderer::pick_entity(uint32_t cursor_x, uint32_t cursor_y, float length) const {
+    glm::mat4 inverse_view_projection = glm::inverse(m_transforms.view_projection);
+    glm::vec2 device{
+        ((float)cursor_x / (float)m_window_extent.width - 0.5f) * 2.0f,
+        ((float)cursor_y / (float)m_window_extent.height - 0.5f) * 2.0f,
+    };
+
+    glm::vec4 near_point = inverse_view_projection * glm::vec4(device, 0.0f, 1.0f);
+    glm::vec4 far_point = inverse_view_projection * glm::vec4(device, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+    glm::vec3 direction = glm::normalize(glm::vec3(far_point) / far_point.w - origin);
+
+    // Boxes are all there is to hit, and the camera is often inside a big
+    // one (a level, say). Those are only picked when nothing else is, the
+    // one left soonest winning.
+    std::optional<uint32_t> hit, surrounding_hit;
+    float nearest = length, nearest_exit = length;
+
+    m_scene_index.raycast(origin, direction, length, [&](uint32_t e_id, float enter, float exit) {
+        if (enter > 0.0f && enter < nearest) {
+            hit = e_id;
+            nearest = enter;
+        } else if (enter == 0.0f && exit < nearest_exit) {
+            surrounding_hit = e_id;
+            nearest_exit = exit;
+        }
+        return nearest;
+    });
+
+    return hit.has_value() ? hit : surrounding_hit;
+}
+
+void Renderer::gather_instances() {
+    const auto &entity_group = ecs::EntityGroup::get();
+
+    m_instance_draws.clear();
+    m_instance_nodes.clear();
+    m_draw_batches.clear();
+    m_draw_order.clear();
+    m_draw_runs.clear();
+
+    // whole entities first, so the nodes of ones out of view are never walked
+    m_cull_entities.clear();
+    m_scene_index.cull(m_frustum, m_cull_entities);
+
+    m_primitive_draws.clear();
+    m_primitive_boxes.clear();
+
+    const glm::vec3 camera_position = m_camera.get_position();
+    const float projection_scale = std::abs(m_transforms.projection[1][1]);
+
+    for (uint32_t e_id : m_cull_entities) {
+        uint32_t model_id = entity_group.get_component<Renderable>(e_id).model_id;
+        const auto &model = m_asset_manager.get_model(model_id);
+
+        uint32_t proxy = entity_group.get_component<RenderBounds>(e_id).scene_proxy;
+        if (proxy >= m_proxy_lods.size())
+            m_proxy_lods.resize(proxy + 1);
+        std::vector<uint8_t> &entity_lods = m_proxy_lods[proxy];
+        uint32_t entity_draw = 0;
+
+        glm::mat4 entity_transform_matrix{ 1.0f };
+        if (entity_group.has_component<Transformable>(e_id))
+            entity_transform_matrix = entity_group.get_component<Transformable>(e_id).transform_matrix;
+
+        // the GPU tests every primitive against the entity's bounds
+        const Sphere &bounds = entity_group.get_component<RenderBounds>(e_id).bounding_sphere;
+        glm::vec4 bounding_sphere{ bounds.center, bounds.radius };
+
+        const Animated *animated = entity_group.has_component<Animated>(e_id) ? &entity_group.get_component<Animated>(e_id) : nullptr;
+
+        // primitives of large models, like a whole level, are also culled
+        // one by one, their draws wait below until the boxes are tested
+        const bool cull_primitives = model.primitives.size() >= MIN_PRIMITIVES_TO_CULL;
+
+        const auto add_node = [&](const GPUNode &node, const glm::mat4 &transform) {
+            uint32_t node_idx = m_instance_nodes.size();
+            m_instance_nodes.push_back(InstanceNode{ transform, bounding_sphere });
+            for (uint32_t primitive_idx : node.primitives) {
+                const GPUPrimitive &primitive = model.primitives[primitive_idx];
+                if (entity_draw >= entity_lods.size())
+                    entity_lods.resize(entity_draw + 1, 0);
+                uint8_t &lod = entity_lods[entity_draw++];
+
+                if (primitive.lod_count > 1) {
+                    // diameter of the primitive's sphere over the screen height
+                    glm::vec3 center = transform * glm::vec4(primitive.bounding_box.center(), 1.0f);
+                    float scale = std::sqrt(std::max({ glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+                                                       glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+                                                       glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])) }));
+                    float radius = 0.5f * glm::distance(primitive.bounding_box.min, primitive.bounding_box.max) * scale;
+                    float distance = glm::distance(camera_position, center);
+                    float size = distance > radius ? radius * projection_scale / distance : std::numeric_limits<float>::max();
+
+                    while (lod + 1u < primitive.lod_count && size < LOD_SCREEN_SIZES[lod] * (1.0f - LOD_HYSTERESIS))
+                        lod++;
+                    while (lod > 0 && size > LOD_SCREEN_SIZES[lod - 1] * (1.0f + LOD_HYSTERESIS))
+                        lod--;
+                }
+                lod = std::min<uint32_t>(lod, primitive.lod_count - 1);
+
+                InstanceDraw draw{ draw_key(model_id, primitive_idx, lod), node_idx };
+                if (!cull_primitives) {
+                    m_instance_draws.push_back(draw);
+                    continue;
+                }
+
+                Box primitive_box = primitive.bounding_box;
+                primitive_box.transform(transform);
+                m_primitive_boxes.push_back(primitive_box);
+                m_primitive_draws.push_back(draw);
+            }
+        };
+
+        if (animated) {
+            // parents come first, so their entry is final when a child reads it
+            m_node_palette.resize(model.flat_nodes.size());
+            for (uint32_t i = 0; i < model.flat_nodes.size(); i++) {
+                const auto &flat_node = model.flat_nodes[i];
+                const GPUNode &node = model.nodes[flat_node.node];
+                const glm::mat4 &parent_transform = flat_node.parent < 0 ? entity_transform_matrix : m_node_palette[flat_node.parent];
+                m_node_palette[i] = parent_transform * animated->transform_for_node(node.id);
+
+                if (!node.primitives.empty())
+                    add_node(node, m_node_palette[i]);
+            }
+        } else {
+            for (uint32_t flat_idx : model.drawable_nodes) {
+                const auto &flat_node = model.flat_nodes[flat_idx];
+                add_node(model.nodes[flat_node.node], entity_transform_matrix * flat_node.model_transform);
+            }
+        }
+    }
+
+    m_primitive_boxes.cull(m_frustum, m_cull_visible);
+    for (uint32_t i = 0; i < m_primitive_draws.size(); i++) {
+        if (m_cull_visible[i])
+            m_instance_draws.push_back(m_primitive_draws[i]);
+    }
+
+    // stable, so instances of a batch keep the order their nodes were gathered in
+    radix_sort(m_instance_draws, m_instance_draws_scratch, [](const InstanceDraw &draw) {
+        return draw.key;
+    });
+
+    for (uint32_t first = 0; first < m_instance_draws.size(); ) {
+        uint64_t key = m_instance_draws[first].key;
+        uint32_t model_id = key_model(key);
+        const auto &model = m_asset_manager.get_model(model_id);
+        const auto &primitive = model.primitives[key_primitive(key)];
+        const auto &material = m_asset_manager.get_material(primitive.material);
+
+        float nearest = FAR_PLANE;
+        uint32_t end = first;
+        for (; end < m_instance_draws.size() && m_instance_draws[end].key == key; end++) {
+            const glm::vec4 &sphere = m_instance_nodes[m_instance_draws[end].node].bounding_sphere;
+            nearest = std::min(nearest, glm::distance(camera_position, glm::vec3(sphere)) - sphere.w);
+        }
+
+        // textured materials of a model share the model's texture set
+        uint32_t descriptor_set = model.lighting == LightingInteractivity::BlinnPhong ? (1u << 15) : 0;
+        if ((VkDescriptorSet)material.texture_set != VK_NULL_HANDLE && material.color_type == GPUMaterial::ColorType::Texture)
+            descriptor_set |= (model_id + 1) & 0x7fff;
+
+        uint64_t state_key = sort_key::make(DrawPass::Opaque, material.pipeline_id, descriptor_set, primitive.material,
+            sort_key::depth_bucket(nearest, FAR_PLANE));
+
+        m_draw_order.push_back(m_draw_batches.size());
+        m_draw_batches.push_back(DrawBatch{ key, state_key, first, end - first, 0 });
+        first = end;
+    }
+
+    radix_sort(m_draw_order, m_draw_order_scratch, [&](uint32_t batch) {
+        return m_draw_batches[batch].state_key;
+    });
+
+    // following batches with the same material and lighting only differ in
+    // their command, which already holds the index and vertex offsets
+    const auto batch_material = [&](uint32_t slot) {
+        uint64_t key = m_draw_batches[m_draw_order[slot]].key;
+        const auto &model = m_asset_manager.get_model(key_model(key));
+        return std::make_pair(model.primitives[key_primitive(key)].material, model.lighting);
+    };
+
+    const uint32_t max_run = m_device_properties.limits.maxDrawIndirectCount;
+    for (uint32_t slot = 0; slot < m_draw_order.size(); ) {
+        auto material = batch_material(slot);
+        uint32_t end = slot + 1;
+        while (end < m_draw_order.size() && end - slot < max_run && batch_material(end) == material)
+            end++;
+
+        m_draw_runs.push_back(DrawRun{ slot, end - slot });
+        slot = end;
+    }
+}
+
+void Renderer::reserve_draw_buffers(size_t object_count, size_t batch_count) {
+    PerFrame &frame = current_frame();
+    if (object_count <= frame.object_capacity && batch_count <= frame.batch_capacity)
+        return;
+
+    // the frame's fence was waited on, so its old buffers are no longer in use
+    if (object_count > frame.object_capacity) {
+        vmaDestroyBuffer(m_allocator, frame.object_buffer.buffer, frame.object_buffer.allocation);
+        vmaDestroyBuffer(m_allocator, frame.visible_buffer.buffer, frame.visible_buffer.allocation);
+
+        frame.object_capacity = std::max(object_count, frame.object_capacity * 2);
+        frame.object_buffer = create_mapped_buffer(frame.object_capacity * sizeof(GPUObject),
+            vk::BufferUsageFlagBits::eStorageBuffer, reinterpret_cast<void **>(&frame.objects));
+        frame.visible_buffer = create_buffer(frame.object_capacity * sizeof(uint32_t),
+            vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+
+    if (batch_count > frame.batch_capacity) {
+        vmaDestroyBuffer(m_allocator, frame.indirect_buffer.buffer, frame.indirect_buffer.allocation);
+
+        frame.batch_capacity = std::max(batch_count, frame.batch_capacity * 2);
+        frame.indirect_buffer = create_mapped_buffer(frame.batch_capacity * sizeof(vk::DrawIndexedIndirectCommand),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, reinterpret_cast<void **>(&frame.commands));
+    }
+
+    write_draw_descriptors(frame);
+}
+
+void Renderer::write_draw_descriptors(PerFrame &frame) {
+    vk::DescriptorBufferInfo object_buffer_info{
+        .buffer = frame.object_buffer.buffer,
+        .offset = 0,
+        .range  = frame.object_capacity * sizeof(GPUObject),
+    };
+
+    vk::DescriptorBufferInfo visible_buffer_info{
+        .buffer = frame.visible_buffer.buffer,
+        .offset = 0,
+        .range  = frame.object_capacity * sizeof(uint32_t),
+    };
+
+    vk::DescriptorBufferInfo indirect_buffer_info{
+        .buffer = frame.indirect_buffer.buffer,
+        .offset = 0,
+        .range  = frame.batch_capacity * sizeof(vk::DrawIndexedIndirectCommand),
+    };
+
+    const auto storage_write = [](vk::DescriptorSet set, uint32_t binding, const vk::DescriptorBufferInfo *buffer_info) {
+        return vk::WriteDescriptorSet{
+            .dstSet             = set,
+            .dstBinding         = binding,
+            .dstArrayElement    = 0,
+            .descriptorCount    = 1,
+            .descriptorType     = vk::DescriptorType::eStorageBuffer,
+            .pImageInfo         = nullptr,
+            .pBufferInfo        = buffer_info,
+            .pTexelBufferView   = nullptr,
+        };
+    };
+
+    std::array<vk::WriteDescriptorSet, 7> set_writes{
+        storage_write(frame.parent_set, OBJECT_BINDING, &object_buffer_info),
+        storage_write(frame.parent_set, VISIBLE_BINDING, &visible_buffer_info),
+        storage_write(frame.parent_blinn_phong_set, OBJECT_BINDING, &object_buffer_info),
+        storage_write(frame.parent_blinn_phong_set, VISIBLE_BINDING, &visible_buffer_info),
+        storage_write(frame.cull_set, 0, &object_buffer_info),
+        storage_write(frame.cull_set, 1, &indirect_buffer_info),
+        storage_write(frame.cull_set, 2, &visible_buffer_info),
+    };
+
+    m_device.get().updateDescriptorSets(set_writes, 0);
+}
+
+void Renderer::prepare_renderables(vk::CommandBuffer cmd) {
+    // the camera the depth pyramid gets built from
+    const Transformations previous_transforms = m_transforms;
+
     m_transforms.view = glm::lookAt(
         m_camera.get_position(),
         m_camera.get_position() + m_camera.get_target(),
@@ -315,19 +640,20 @@ void Renderer::draw_renderables(vk::CommandBuffer cmd) {
     m_transforms.projection = glm::perspective(
         glm::radians(90.0f),
         m_window_extent.width / (float)m_window_extent.height,
-        0.1f,
-        500.0f);
+        NEAR_PLANE,
+        FAR_PLANE);
 
     m_transforms.projection[1][1] *= -1;
     m_transforms.view_projection = m_transforms.projection * m_transforms.view;
     m_transforms.skybox_view_projection = m_transforms.projection * glm::mat4(glm::mat3(m_transforms.view));
 
-    void *data;
-    vmaMapMemory(m_allocator, current_frame().transformations_buffer.allocation, &data);
-    memcpy(data, &m_transforms, sizeof(Transformations));
-    vmaUnmapMemory(m_allocator, current_frame().transformations_buffer.allocation);
+    m_uniform_ring.begin_frame(m_frame % FRAMES_IN_FLIGHT);
+    current_frame().transformations_offset = m_uniform_ring.write(m_transforms);
 
-    auto &entity_group = ecs::EntityGroup::get();
+    update_render_bounds();
+
+    // drawing only reads, a const group keeps it from marking components changed
+    const auto &entity_group = ecs::EntityGroup::get();
 
     BlinnPhong blinn_phong;
 
@@ -354,176 +680,349 @@ void Renderer::draw_renderables(vk::CommandBuffer cmd) {
     blinn_phong.point_lights_count = count;
     blinn_phong.camera_position = m_camera.get_position();
 
-    vmaMapMemory(m_allocator, current_frame().blinn_phong_buffer.allocation, &data);
-    memcpy(data, &blinn_phong, sizeof(BlinnPhong));
-    vmaUnmapMemory(m_allocator, current_frame().blinn_phong_buffer.allocation);
+    current_frame().blinn_phong_offset = m_uniform_ring.write(blinn_phong);
+
+    OcclusionConstants occlusion{
+        .view           = previous_transforms.view,
+        .projection     = {
+            previous_transforms.projection[0][0],
+            previous_transforms.projection[1][1],
+            previous_transforms.projection[2][2],
+            previous_transforms.projection[3][2],
+        },
+        .pyramid_size   = glm::vec2(m_window_extent.width, m_window_extent.height),
+        .pyramid_levels = m_depth_pyramid_levels,
+        .enabled        = m_depth_pyramid_ready,
+    };
+    current_frame().occlusion_offset = m_uniform_ring.write(occlusion);
 
     m_frustum.update(m_transforms.view_projection);
 
-    // TODO: figure out how to do instanced rendering
-    entity_group.for_each_entity_with_component<Renderable>([&](auto &e_id) {
-        auto &renderable = entity_group.get_component<Renderable>(e_id);
-        auto &model = m_asset_manager.get_model(renderable.model_id);
+    gather_instances();
+    reserve_draw_buffers(m_instance_draws.size(), m_draw_batches.size());
 
-        if (model.nodes.size() == 0)
-            return Iteration::Continue;
+    PerFrame &frame = current_frame();
 
-        glm::mat4 entity_transform_matrix{ 1.0f };
-        if (entity_group.has_component<Transformable>(e_id))
-            entity_transform_matrix = entity_group.get_component<Transformable>(e_id).transform_matrix;
+    // commands are laid out in draw order, so batches drawn back to back
+    // with the same state can share one multi draw
+    for (uint32_t slot = 0; slot < m_draw_order.size(); slot++)
+        m_draw_batches[m_draw_order[slot]].command = slot;
 
-        Box transform_bounding_box = model.bounding_box;
-        transform_bounding_box.transform(entity_transform_matrix);
-        Sphere bounding_sphere = Sphere::bounding_sphere_from_bounding_box(transform_bounding_box);
-        if (!m_frustum.is_sphere_within(bounding_sphere.center, bounding_sphere.radius))
-            return Iteration::Continue;
-
-        bool is_animated = entity_group.has_component<Animated>(e_id);
-
-        const auto draw_node = [&](const auto &node, glm::mat4 local_transform) {
-            auto draw_node_impl = [&](const auto &node, glm::mat4 local_transform, auto &draw_node_ref) mutable -> void {
-                if (is_animated)
-                    local_transform *= entity_group.get_component<Animated>(e_id).transform_for_node(node.id);
-                else
-                    local_transform *= node.transform_matrix;
-
-                glm::mat4 model_view_projection = m_transforms.view_projection * local_transform;
-
-                size_t last_material = std::numeric_limits<size_t>::max();
-                for (size_t primitive_idx : node.primitives) {
-                    const auto &primitive = model.primitives[primitive_idx];
-
-                    PushConstants push_constants = {
-                        .extra0 = { -1, -1, -1, -1 },
-                        .extra1 = { 0.f, 0.f, 0.f, 0.f },
-                        .model_view_projection = model_view_projection,
-                    };
-
-                    auto &material = m_asset_manager.get_material(primitive.material);
-                    if (primitive.material != last_material) {
-                        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, material.pipeline);
-                        last_material = primitive.material;
-
-                        switch (model.lighting) {
-                        case LightingInteractivity::BlinnPhong:
-                            cmd.bindDescriptorSets(
-                                vk::PipelineBindPoint::eGraphics,
-                                material.pipeline_layout,
-                                0,
-                                current_frame().parent_blinn_phong_set,
-                                nullptr);
-                            push_constants.model_view_projection = local_transform;
-                            break;
-                        case LightingInteractivity::Unlit:
-                            cmd.bindDescriptorSets(
-                                vk::PipelineBindPoint::eGraphics,
-                                material.pipeline_layout,
-                                0,
-                                current_frame().parent_set,
-                                nullptr);
-                            break;
-                        }
-
-                        push_constants.extra0[1] = static_cast<int32_t>(material.color_type);
-
-                        if ((VkDescriptorSet)material.texture_set != VK_NULL_HANDLE && material.color_type == GPUMaterial::ColorType::Texture) {
-                            cmd.bindDescriptorSets(
-                                vk::PipelineBindPoint::eGraphics,
-                                material.pipeline_layout,
-                                1,
-                                material.texture_set,
-                                nullptr);
-                            push_constants.extra0[0] = material.descriptor_number;
-                        } else {
-                            push_constants.extra0[0] = -1;
-                        }
-                    }
-
-                    cmd.pushConstants(material.pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants), &push_constants);
-
-                    vk::Buffer vertex_buffers[] = { model.vertex_buffer.buffer };
-                    vk::DeviceSize offsets[] = { 0 };
-                    cmd.bindVertexBuffers(0, 1, vertex_buffers, offsets);
-                    cmd.bindIndexBuffer(primitive.index_buffer.buffer, 0, vk::IndexType::eUint32);
-
-                    cmd.drawIndexed(primitive.index_count, 1, 0, 0, 0);
-                }
+    // objects go to the GPU in batch order, so a batch's visible instances
+    // are packed into the range starting at its first object
+    for (const DrawBatch &draw_batch : m_draw_batches) {
+        for (uint32_t i = draw_batch.first; i < draw_batch.first + draw_batch.count; i++) {
+            const InstanceNode &node = m_instance_nodes[m_instance_draws[i].node];
+            frame.objects[i] = GPUObject{ node.transform, node.bounding_sphere, draw_batch.command, {} };
+        }
+    }
+
+    // instance counts start at zero and are counted up by the cull pass
+    for (const DrawBatch &draw_batch : m_draw_batches) {
+        const auto &model = m_asset_manager.get_model(key_model(draw_batch.key));
+        const auto &lod = model.primitives[key_primitive(draw_batch.key)].lods[key_lod(draw_batch.key)];
+        frame.commands[draw_batch.command] = vk::DrawIndexedIndirectCommand{
+            .indexCount     = lod.index_count,
+            .instanceCount  = 0,
+            .firstIndex     = lod.first_index,
+            .vertexOffset   = static_cast<int32_t>(model.vertex_offset),
+            .firstInstance  = draw_batch.first,
+        };
+    }
+
+    if (m_instance_draws.empty())
+        return;
+
+    CullConstants cull_constants;
+    std::copy(m_frustum.planes.begin(), m_frustum.planes.end(), cull_constants.planes);
+    cull_constants.object_count = m_instance_draws.size();
+
+    if (m_depth_pyramid_ready)
+        build_depth_pyramid(cmd);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_cull_pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_cull_pipeline_layout, 0, frame.cull_set, frame.occlusion_offset);
+    cmd.pushConstants(m_cull_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants), &cull_constants);
+    cmd.dispatch((m_instance_draws.size() + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+    vk::MemoryBarrier cull_barrier{
+        .srcAccessMask  = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask  = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead,
+    };
 
-                for (size_t child_idx : node.children)
-                    draw_node_ref(model.nodes[child_idx], local_transform, draw_node_ref);
-            };
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+        vk::DependencyFlags{},
+        cull_barrier,
+        nullptr,
+        nullptr);
+}
 
-            draw_node_impl(node, local_transform, draw_node_impl);
+// Reduces the last frame's depth into m_depth_pyramid, one dispatch per
+// level, each reading the level the one before it wrote.
+void Renderer::build_depth_pyramid(vk::CommandBuffer cmd) {
+    // the last frame's cull pass is done reading the pyramid
+    vk::MemoryBarrier read_barrier{
+        .srcAccessMask  = vk::AccessFlagBits::eShaderRead,
+        .dstAccessMask  = vk::AccessFlagBits::eShaderWrite,
+    };
+
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags{},
+        read_barrier,
+        nullptr,
+        nullptr);
+
+    vk::MemoryBarrier level_barrier{
+        .srcAccessMask  = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask  = vk::AccessFlagBits::eShaderRead,
+    };
+
+    glm::uvec2 source_size{ m_window_extent.width, m_window_extent.height };
+    for (uint32_t level = 0; level < m_depth_pyramid_levels; level++) {
+        // level 0 copies the depth image, or takes the furthest of its samples
+        const bool resolve = level == 0 && m_msaa_samples != vk::SampleCountFlagBits::e1;
+
+        DepthPyramidConstants constants{
+            .source_size    = source_size,
+            .size           = level == 0 ? source_size : glm::max(source_size / 2u, glm::uvec2(1u)),
+            .stride         = level == 0 ? 1u : 2u,
         };
 
-        for (size_t node_idx : model.root_nodes)
-            draw_node(model.nodes[node_idx], entity_transform_matrix);
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, resolve ? m_depth_resolve_pipeline : m_depth_reduce_pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_depth_pyramid_pipeline_layout, 0,
+            m_depth_pyramid_sets[level], nullptr);
+        cmd.pushConstants(m_depth_pyramid_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0,
+            sizeof(DepthPyramidConstants), &constants);
+        cmd.dispatch(
+            (constants.size.x + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE,
+            (constants.size.y + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE,
+            1);
+
+        // the next level, or the cull pass after the last one, reads it
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::DependencyFlags{},
+            level_barrier,
+            nullptr,
+            nullptr);
+
+        source_size = constants.size;
+    }
+}
+
+vk::CommandBuffer Renderer::begin_secondary_commands(RecordContext &context) {
+    if (context.used == context.command_buffers.size()) {
+        auto alloc_info = command_buffer_allocate_info(context.command_pool, 1, vk::CommandBufferLevel::eSecondary);
+        context.command_buffers.push_back(m_device.get().allocateCommandBuffers(alloc_info)[0]);
+    }
 
-        auto &bounding_box_material = m_asset_manager.get_material(BOUNDING_BOX_MATERIAL_INDEX);
-        if (m_draw_bounding_boxes || (entity_group.has_component<boa::ngn::EngineSelectable>(e_id) &&
-                                      entity_group.get_component<boa::ngn::EngineSelectable>(e_id).selected)) {
-            PushConstants push_constants = {
-                .extra0 = { -1, -1, -1, -1 },
-                .extra1 = { 1.f, 0.f, 0.f, 0.6f },
-                .model_view_projection = m_transforms.view_projection * entity_transform_matrix,
-            };
+    vk::CommandBuffer cmd = context.command_buffers[context.used++];
 
-            if (m_draw_bounding_boxes)
-                push_constants.extra1 = { 0.f, 0.f, 1.f, 6.f };
+    vk::CommandBufferInheritanceInfo inheritance_info{
+        .renderPass     = m_renderpass,
+        .subpass        = 0,
+        .framebuffer    = m_framebuffer,
+    };
 
-            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, bounding_box_material.pipeline);
+    vk::CommandBufferBeginInfo begin_info{
+        .flags              = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        .pInheritanceInfo   = &inheritance_info,
+    };
 
-            cmd.pushConstants(bounding_box_material.pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants), &push_constants);
+    cmd.begin(begin_info);
 
-            vk::Buffer vertex_buffers[] = { model.bounding_box_vertex_buffer.buffer };
-            vk::DeviceSize offsets[] = { 0 };
-            cmd.bindVertexBuffers(0, 1, vertex_buffers, offsets);
+    // dynamic state is not inherited from the primary
+    vk::Viewport viewport{
+        .x          = 0.0f,
+        .y          = 0.0f,
+        .width      = (float)m_window_extent.width,
+        .height     = (float)m_window_extent.height,
+        .minDepth   = 0.0f,
+        .maxDepth   = 1.0f,
+    };
 
-            cmd.draw(24, 1, 0, 0);
+    vk::Rect2D scissor{
+        .offset = { .x = 0, .y = 0 },
+        .extent = m_window_extent,
+    };
+
+    cmd.setViewport(0, viewport);
+    cmd.setScissor(0, scissor);
+
+    return cmd;
+}
+
+RenderStatistics Renderer::record_draw_runs(vk::CommandBuffer cmd, size_t begin, size_t end) {
+    PerFrame &frame = current_frame();
+
+    // runs come sorted by state, the emitter drops whatever is already bound
+    CommandEmitter emitter(cmd);
+
+    // in binding order
+    const std::array<uint32_t, 2> blinn_phong_offsets{ frame.transformations_offset, frame.blinn_phong_offset };
+
+    // every model lives in the same arenas
+    emitter.bind_vertex_buffer(m_asset_manager.get_vertex_buffer());
+    emitter.bind_index_buffer(m_asset_manager.get_index_buffer());
+
+    uint32_t triangles = 0, full_detail_triangles = 0;
+
+    for (size_t run = begin; run < end; run++) {
+        const DrawRun &draw_run = m_draw_runs[run];
+        uint64_t key = m_draw_batches[m_draw_order[draw_run.first_slot]].key;
+        const auto &model = m_asset_manager.get_model(key_model(key));
+        const auto &primitive = model.primitives[key_primitive(key)];
+        const auto &material = m_asset_manager.get_material(primitive.material);
+
+        emitter.bind_pipeline(material.pipeline);
+
+        switch (model.lighting) {
+        case LightingInteractivity::BlinnPhong:
+            emitter.bind_descriptor_set(material.pipeline_layout, 0, frame.parent_blinn_phong_set, blinn_phong_offsets);
+            break;
+        case LightingInteractivity::Unlit:
+            emitter.bind_descriptor_set(material.pipeline_layout, 0, frame.parent_set, frame.transformations_offset);
+            break;
         }
 
-        return Iteration::Continue;
-    });
+        // the model matrix comes from the object buffer
+        PushConstants push_constants = {
+            .extra0 = { -1, static_cast<int32_t>(material.color_type), -1, -1 },
+            .extra1 = { 0.f, 0.f, 0.f, 0.f },
+            .model_view_projection = glm::mat4{ 1.0f },
+        };
+
+        if ((VkDescriptorSet)material.texture_set != VK_NULL_HANDLE && material.color_type == GPUMaterial::ColorType::Texture) {
+            emitter.bind_descriptor_set(material.pipeline_layout, 1, material.texture_set);
+            push_constants.extra0[0] = material.descriptor_number;
+        }
+
+        emitter.push_constants(material.pipeline_layout, vk::ShaderStageFlagBits::eVertex, sizeof(PushConstants), &push_constants);
+
+        emitter.draw_indexed_indirect(frame.indirect_buffer.buffer, draw_run.first_slot * sizeof(vk::DrawIndexedIndirectCommand),
+            draw_run.count, sizeof(vk::DrawIndexedIndirectCommand));
+
+        for (uint32_t slot = draw_run.first_slot; slot < draw_run.first_slot + draw_run.count; slot++) {
+            const DrawBatch &draw_batch = m_draw_batches[m_draw_order[slot]];
+            const auto &batch_model = m_asset_manager.get_model(key_model(draw_batch.key));
+            const auto &batch_primitive = batch_model.primitives[key_primitive(draw_batch.key)];
+            triangles += draw_batch.count * (batch_primitive.lods[key_lod(draw_batch.key)].index_count / 3);
+            full_detail_triangles += draw_batch.count * (batch_primitive.lods[0].index_count / 3);
+        }
+    }
+
+    RenderStatistics statistics = emitter.statistics();
+    statistics.triangles = triangles;
+    statistics.full_detail_triangles = full_detail_triangles;
+    return statistics;
+}
+
+RenderStatistics Renderer::record_overlays(vk::CommandBuffer cmd) {
+    const auto &entity_group = ecs::EntityGroup::get();
+    CommandEmitter emitter(cmd);
+
+    // few entities get a box, so these are culled on the CPU
+    auto &bounding_box_material = m_asset_manager.get_material(BOUNDING_BOX_MATERIAL_INDEX);
+    for (uint32_t e_id : entity_group.view<Renderable>().entities()) {
+        if (!m_draw_bounding_boxes && !(entity_group.has_component<boa::ngn::EngineSelectable>(e_id) &&
+                                        entity_group.get_component<boa::ngn::EngineSelectable>(e_id).selected))
+            continue;
+
+        if (!m_frustum.is_box_within(entity_group.get_component<RenderBounds>(e_id).bounding_box))
+            continue;
+
+        auto &model = m_asset_manager.get_model(entity_group.get_component<Renderable>(e_id).model_id);
+        if (model.nodes.size() == 0)
+            continue;
+
+        glm::mat4 entity_transform_matrix{ 1.0f };
+        if (entity_group.has_component<Transformable>(e_id))
+            entity_transform_matrix = entity_group.get_component<Transformable>(e_id).transform_matrix;
+
+        PushConstants push_constants = {
+            .extra0 = { -1, -1, -1, -1 },
+            .extra1 = { 1.f, 0.f, 0.f, 0.6f },
+            .model_view_projection = m_transforms.view_projection * entity_transform_matrix,
+        };
+
+        if (m_draw_bounding_boxes)
+            push_constants.extra1 = { 0.f, 0.f, 1.f, 6.f };
+
+        emitter.bind_pipeline(bounding_box_material.pipeline);
+        emitter.push_constants(bounding_box_material.pipeline_layout, vk::ShaderStageFlagBits::eVertex, sizeof(PushConstants), &push_constants);
+        emitter.bind_vertex_buffer(m_asset_manager.get_bounding_box_vertex_buffer());
+        emitter.draw(24, model.bounding_box_first_vertex);
+    }
 
     auto skybox_e = m_asset_manager.get_active_skybox();
     if (skybox_e.has_value()) {
         auto &skybox = entity_group.get_component<GPUSkybox>(skybox_e.value());
-        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_skybox_pipeline);
-        cmd.bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics,
-            m_skybox_pipeline_layout,
-            0,
-            current_frame().parent_set,
-            nullptr);
-        cmd.bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics,
-            m_skybox_pipeline_layout,
-            1,
-            skybox.skybox_set,
-            nullptr);
-
-        vk::Buffer vertex_buffers[] = { m_skybox_vertex_buffer.buffer };
-        vk::DeviceSize offsets[] = { 0 };
-        cmd.bindVertexBuffers(0, 1, vertex_buffers, offsets);
-        cmd.bindIndexBuffer(m_skybox_index_buffer.buffer, 0, vk::IndexType::eUint32);
-
-        cmd.drawIndexed(skybox_indices.size(), 1, 0, 0, 0);
+        emitter.bind_pipeline(m_skybox_pipeline);
+        emitter.bind_descriptor_set(m_skybox_pipeline_layout, 0, current_frame().parent_set, current_frame().transformations_offset);
+        emitter.bind_descriptor_set(m_skybox_pipeline_layout, 1, skybox.skybox_set);
+        emitter.bind_vertex_buffer(m_skybox_vertex_buffer.buffer);
+        emitter.bind_index_buffer(m_skybox_index_buffer.buffer);
+        emitter.draw_indexed(skybox_indices.size());
     }
 
     // currently we reuse the bounding box pipeline for debug drawing
-    auto &bounding_box_material = m_asset_manager.get_material(BOUNDING_BOX_MATERIAL_INDEX);
     for (DebugDrawer *debug_drawer : m_debug_drawers) {
-        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, bounding_box_material.pipeline);
+        emitter.bind_pipeline(bounding_box_material.pipeline);
 
         PushConstants push_constants = {
             .extra0 = { -1, -1, -1, -1 },
             .extra1 = glm::vec4(debug_drawer->get_color(), 1.0f),
             .model_view_projection = m_transforms.view_projection,
         };
-        cmd.pushConstants(bounding_box_material.pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants), &push_constants);
+        emitter.push_constants(bounding_box_material.pipeline_layout, vk::ShaderStageFlagBits::eVertex, sizeof(PushConstants), &push_constants);
 
+        // the drawer binds its own vertex buffer
         debug_drawer->record(cmd);
+        emitter.invalidate();
     }
+
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+
+    return emitter.statistics();
+}
+
+void Renderer::draw_renderables(vk::CommandBuffer cmd) {
+    PerFrame &frame = current_frame();
+    auto &thread_pool = ThreadPool::get();
+
+    // chunks of runs go to the workers, each into its own secondary buffer
+    const size_t chunk_size = std::max<size_t>(MIN_RUNS_PER_RECORD_CHUNK,
+        (m_draw_runs.size() + thread_pool.thread_count() - 1) / thread_pool.thread_count());
+    const size_t chunk_count = (m_draw_runs.size() + chunk_size - 1) / chunk_size;
+
+    m_secondary_buffers.assign(chunk_count + 1, vk::CommandBuffer{});
+    m_secondary_statistics.assign(chunk_count + 1, RenderStatistics{});
+
+    thread_pool.parallel_for(m_draw_runs.size(), chunk_size, [&](size_t begin, size_t end) {
+        size_t chunk = begin / chunk_size;
+        vk::CommandBuffer secondary = begin_secondary_commands(frame.record_contexts[ThreadPool::thread_index()]);
+        m_secondary_statistics[chunk] = record_draw_runs(secondary, begin, end);
+        secondary.end();
+        m_secondary_buffers[chunk] = secondary;
+    });
+
+    // overlays and the interface go last, on this thread
+    vk::CommandBuffer overlay = begin_secondary_commands(frame.record_contexts[ThreadPool::thread_index()]);
+    m_secondary_statistics[chunk_count] = record_overlays(overlay);
+    overlay.end();
+    m_secondary_buffers[chunk_count] = overlay;
+
+    cmd.executeCommands(m_secondary_buffers);
+
+    m_render_statistics = RenderStatistics{};
+    for (const RenderStatistics &statistics : m_secondary_statistics)
+        m_render_statistics += statistics;
+    m_render_statistics.command_buffers = m_secondary_buffers.size();
 }
 
 void Renderer::create_skybox_resources() {
@@ -725,6 +1224,8 @@ void Renderer::create_logical_device() {
     }
 
     vk::PhysicalDeviceFeatures device_features{
+        .multiDrawIndirect                      = true,
+        .drawIndirectFirstInstance              = true,
         .samplerAnisotropy                      = true,
         .shaderSampledImageArrayDynamicIndexing = true,
     };
@@ -801,6 +1302,8 @@ bool Renderer::check_device(vk::PhysicalDevice device) const {
         extensions_supported &&
         swap_chain_adequate &&
         supported_features.samplerAnisotropy &&
+        supported_features.multiDrawIndirect &&
+        supported_features.drawIndirectFirstInstance &&
         more_features.get<vk::PhysicalDeviceVulkan12Features>().imagelessFramebuffer;
 }
 
@@ -936,7 +1439,7 @@ void Renderer::create_swapchain() {
     m_depth_format = vk::Format::eD32Sfloat;
 
     vk::ImageCreateInfo depth_img_create_info = image_create_info(m_depth_format,
-        vk::ImageUsageFlagBits::eDepthStencilAttachment, img_extent, 1, m_msaa_samples);
+        vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled, img_extent, 1, m_msaa_samples);
 
     VmaAllocationCreateInfo img_alloc_info{
         .usage          = VMA_MEMORY_USAGE_GPU_ONLY,
@@ -1012,6 +1515,124 @@ void Renderer::recreate_swapchain() {
 
     create_swapchain();
     create_framebuffer();
+    create_depth_pyramid();
+}
+
+void Renderer::create_depth_pyramid() {
+    // the depth image has nothing in it until a frame is drawn
+    m_depth_pyramid_ready = false;
+
+    // level sizes round down as for any mip chain, floor(log2) + 1 levels
+    const uint32_t largest_side = std::max(m_window_extent.width, m_window_extent.height);
+    m_depth_pyramid_levels = 1;
+    while (m_depth_pyramid_levels < MAX_DEPTH_PYRAMID_LEVELS && (largest_side >> m_depth_pyramid_levels) > 0)
+        m_depth_pyramid_levels++;
+
+    vk::Extent3D img_extent = {
+        m_window_extent.width,
+        m_window_extent.height,
+        1,
+    };
+
+    vk::ImageCreateInfo pyramid_img_create_info = image_create_info(vk::Format::eR32Sfloat,
+        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled, img_extent, m_depth_pyramid_levels);
+
+    VmaAllocationCreateInfo img_alloc_info{
+        .usage          = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags  = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+    };
+
+    vmaCreateImage(
+        m_allocator,
+        reinterpret_cast<VkImageCreateInfo *>(&pyramid_img_create_info),
+        &img_alloc_info,
+        reinterpret_cast<VkImage *>(&m_depth_pyramid.image),
+        &m_depth_pyramid.allocation,
+        nullptr);
+
+    vk::ImageViewCreateInfo pyramid_img_view_create_info = image_view_create_info(vk::Format::eR32Sfloat,
+        m_depth_pyramid.image, vk::ImageAspectFlagBits::eColor, m_depth_pyramid_levels);
+
+    try {
+        m_depth_pyramid_view = m_device.get().createImageView(pyramid_img_view_create_info);
+
+        pyramid_img_view_create_info.subresourceRange.levelCount = 1;
+        for (uint32_t level = 0; level < m_depth_pyramid_levels; level++) {
+            pyramid_img_view_create_info.subresourceRange.baseMipLevel = level;
+            m_depth_pyramid_level_views[level] = m_device.get().createImageView(pyramid_img_view_create_info);
+        }
+    } catch (const vk::SystemError &err) {
+        throw std::runtime_error("Failed to create depth pyramid image views");
+    }
+
+    // stays in the general layout, written as storage and read as sampled
+    immediate_command([&](vk::CommandBuffer cmd) {
+        vk::ImageMemoryBarrier image_barrier_to_general{
+            .srcAccessMask          = vk::AccessFlagBits::eNoneKHR,
+            .dstAccessMask          = vk::AccessFlagBits::eShaderWrite,
+            .oldLayout              = vk::ImageLayout::eUndefined,
+            .newLayout              = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
+            .image                  = m_depth_pyramid.image,
+            .subresourceRange       = {
+                .aspectMask         = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel       = 0,
+                .levelCount         = m_depth_pyramid_levels,
+                .baseArrayLayer     = 0,
+                .layerCount         = 1,
+            },
+        };
+
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe,
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::DependencyFlags{},
+            nullptr,
+            nullptr,
+            image_barrier_to_general);
+    });
+
+    std::vector<vk::DescriptorImageInfo> image_infos;
+    std::vector<vk::WriteDescriptorSet> writes;
+    // pointers into image_infos are taken once it stops growing
+    image_infos.reserve(m_depth_pyramid_levels * 2 + FRAMES_IN_FLIGHT);
+
+    for (uint32_t level = 0; level < m_depth_pyramid_levels; level++) {
+        image_infos.push_back(vk::DescriptorImageInfo{
+            .sampler        = m_depth_pyramid_sampler,
+            .imageView      = level == 0 ? m_depth_image_view : m_depth_pyramid_level_views[level - 1],
+            .imageLayout    = level == 0 ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eGeneral,
+        });
+        writes.push_back(write_descriptor_image(vk::DescriptorType::eCombinedImageSampler,
+            m_depth_pyramid_sets[level], &image_infos.back(), 0));
+
+        image_infos.push_back(vk::DescriptorImageInfo{
+            .imageView      = m_depth_pyramid_level_views[level],
+            .imageLayout    = vk::ImageLayout::eGeneral,
+        });
+        writes.push_back(write_descriptor_image(vk::DescriptorType::eStorageImage,
+            m_depth_pyramid_sets[level], &image_infos.back(), 1));
+    }
+
+    for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        image_infos.push_back(vk::DescriptorImageInfo{
+            .sampler        = m_depth_pyramid_sampler,
+            .imageView      = m_depth_pyramid_view,
+            .imageLayout    = vk::ImageLayout::eGeneral,
+        });
+        writes.push_back(write_descriptor_image(vk::DescriptorType::eCombinedImageSampler,
+            m_frames[i].cull_set, &image_infos.back(), 3));
+    }
+
+    m_device.get().updateDescriptorSets(writes, nullptr);
+
+    m_deletion_queue.enqueue([=]() {
+        for (uint32_t level = 0; level < m_depth_pyramid_levels; level++)
+            m_device.get().destroyImageView(m_depth_pyramid_level_views[level]);
+        m_device.get().destroyImageView(m_depth_pyramid_view);
+        vmaDestroyImage(m_allocator, m_depth_pyramid.image, m_depth_pyramid.allocation);
+    }, SWAPCHAIN_DELETE_TAG);
 }
 
 void Renderer::create_commands() {
@@ -1038,6 +1659,20 @@ void Renderer::create_commands() {
         m_deletion_queue.enqueue([=]() {
             m_device.get().destroyCommandPool(m_frames[i].command_pool);
         });
+
+        m_frames[i].record_contexts.resize(ThreadPool::get().thread_count());
+        for (RecordContext &context : m_frames[i].record_contexts) {
+            try {
+                context.command_pool = m_device.get().createCommandPool(command_pool_create_info(graphics_family_index,
+                    vk::CommandPoolCreateFlagBits::eTransient));
+            } catch (const vk::SystemError &err) {
+                throw std::runtime_error("Failed to create command pool");
+            }
+
+            m_deletion_queue.enqueue([=, command_pool = context.command_pool]() {
+                m_device.get().destroyCommandPool(command_pool);
+            });
+        }
     }
 }
 
@@ -1059,12 +1694,12 @@ void Renderer::create_default_renderpass() {
         .format         = m_depth_format,
         .samples        = m_msaa_samples,
         .loadOp         = vk::AttachmentLoadOp::eClear,
-        // don't care, because depth data won't be used after drawing has finished
-        .storeOp        = vk::AttachmentStoreOp::eDontCare,
+        // kept for the next frame's depth pyramid
+        .storeOp        = vk::AttachmentStoreOp::eStore,
         .stencilLoadOp  = vk::AttachmentLoadOp::eDontCare,
         .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
         .initialLayout  = vk::ImageLayout::eUndefined,
-        .finalLayout    = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        .finalLayout    = vk::ImageLayout::eDepthStencilReadOnlyOptimal,
     };
 
     vk::AttachmentDescription color_attachment_resolve{
@@ -1101,13 +1736,26 @@ void Renderer::create_default_renderpass() {
         .pDepthStencilAttachment    = &depth_attachment_ref,
     };
 
-    vk::SubpassDependency dependency{
-        .srcSubpass     = VK_SUBPASS_EXTERNAL,
-        .dstSubpass     = 0,
-        .srcStageMask   = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
-        .dstStageMask   = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
-        .srcAccessMask  = vk::AccessFlagBits::eNoneKHR,
-        .dstAccessMask  = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+    // the depth pyramid is built from the depth image before the pass
+    // clears it, and from what the pass wrote in the frame after
+    const std::array<vk::SubpassDependency, 2> dependencies = {
+        vk::SubpassDependency{
+            .srcSubpass     = VK_SUBPASS_EXTERNAL,
+            .dstSubpass     = 0,
+            .srcStageMask   = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests
+                            | vk::PipelineStageFlagBits::eComputeShader,
+            .dstStageMask   = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+            .srcAccessMask  = vk::AccessFlagBits::eNoneKHR,
+            .dstAccessMask  = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        },
+        vk::SubpassDependency{
+            .srcSubpass     = 0,
+            .dstSubpass     = VK_SUBPASS_EXTERNAL,
+            .srcStageMask   = vk::PipelineStageFlagBits::eLateFragmentTests,
+            .dstStageMask   = vk::PipelineStageFlagBits::eComputeShader,
+            .srcAccessMask  = vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+            .dstAccessMask  = vk::AccessFlagBits::eShaderRead,
+        },
     };
 
     const std::array<vk::AttachmentDescription, 3> attachments = {
@@ -1122,8 +1770,8 @@ void Renderer::create_default_renderpass() {
         .pAttachments       = attachments.data(),
         .subpassCount       = 1,
         .pSubpasses         = &subpass,
-        .dependencyCount    = 1,
-        .pDependencies      = &dependency,
+        .dependencyCount    = static_cast<uint32_t>(dependencies.size()),
+        .pDependencies      = dependencies.data(),
     };
 
     try {
@@ -1139,7 +1787,7 @@ void Renderer::create_default_renderpass() {
 
 void Renderer::create_framebuffer() {
     vk::FramebufferAttachmentImageInfo depth_attach{
-        .usage              = vk::ImageUsageFlagBits::eDepthStencilAttachment,
+        .usage              = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
         .width              = m_window_extent.width,
         .height             = m_window_extent.height,
         .layerCount         = 1,
@@ -1277,15 +1925,40 @@ VmaBuffer Renderer::create_buffer(size_t size, vk::BufferUsageFlags usage, VmaMe
     return buffer;
 }
 
+VmaBuffer Renderer::create_mapped_buffer(size_t size, vk::BufferUsageFlags usage, void **mapped) const {
+    vk::BufferCreateInfo buffer_info{
+        .size   = size,
+        .usage  = usage,
+    };
+
+    VmaAllocationCreateInfo vma_alloc_info{
+        .flags          = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .usage          = VMA_MEMORY_USAGE_CPU_TO_GPU,
+        .requiredFlags  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+
+    VmaBuffer buffer;
+    VmaAllocationInfo allocation_info;
+    if (vmaCreateBuffer(m_allocator, (VkBufferCreateInfo *)&buffer_info, &vma_alloc_info, (VkBuffer *)&buffer.buffer,
+            &buffer.allocation, &allocation_info) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create mapped buffer");
+
+    *mapped = allocation_info.pMappedData;
+    return buffer;
+}
+
 void Renderer::create_descriptors() {
     std::vector<vk::DescriptorPoolSize> sizes = {
         { vk::DescriptorType::eUniformBuffer,           1000 },
+        { vk::DescriptorType::eUniformBufferDynamic,    1000 },
+        { vk::DescriptorType::eStorageBuffer,           1000 },
         { vk::DescriptorType::eSampler,                 1000 },
         { vk::DescriptorType::eCombinedImageSampler,    1000 },
+        { vk::DescriptorType::eStorageImage,            MAX_DEPTH_PYRAMID_LEVELS },
     };
 
     vk::DescriptorPoolCreateInfo pool_info{
-        .maxSets        = 10,
+        .maxSets        = 10 + FRAMES_IN_FLIGHT + MAX_DEPTH_PYRAMID_LEVELS,
         .poolSizeCount  = (uint32_t)sizes.size(),
         .pPoolSizes     = sizes.data(),
     };
@@ -1296,17 +1969,35 @@ void Renderer::create_descriptors() {
         throw std::runtime_error("Failed to create descriptor pool");
     }
 
+    // per frame uniforms live in m_uniform_ring at a dynamic offset
     vk::DescriptorSetLayoutBinding transform_binding{
         .binding            = 0,
-        .descriptorType     = vk::DescriptorType::eUniformBuffer,
+        .descriptorType     = vk::DescriptorType::eUniformBufferDynamic,
+        .descriptorCount    = 1,
+        .stageFlags         = vk::ShaderStageFlagBits::eVertex,
+        .pImmutableSamplers = nullptr,
+    };
+
+    vk::DescriptorSetLayoutBinding object_binding{
+        .binding            = OBJECT_BINDING,
+        .descriptorType     = vk::DescriptorType::eStorageBuffer,
+        .descriptorCount    = 1,
+        .stageFlags         = vk::ShaderStageFlagBits::eVertex,
+        .pImmutableSamplers = nullptr,
+    };
+
+    vk::DescriptorSetLayoutBinding visible_binding{
+        .binding            = VISIBLE_BINDING,
+        .descriptorType     = vk::DescriptorType::eStorageBuffer,
         .descriptorCount    = 1,
         .stageFlags         = vk::ShaderStageFlagBits::eVertex,
         .pImmutableSamplers = nullptr,
     };
 
+    vk::DescriptorSetLayoutBinding parent_bindings[] = { transform_binding, object_binding, visible_binding };
     vk::DescriptorSetLayoutCreateInfo set_info{
-        .bindingCount   = 1,
-        .pBindings      = &transform_binding,
+        .bindingCount   = 3,
+        .pBindings      = parent_bindings,
     };
 
     try {
@@ -1317,15 +2008,15 @@ void Renderer::create_descriptors() {
 
     vk::DescriptorSetLayoutBinding blinn_phong_binding{
         .binding            = 1,
-        .descriptorType     = vk::DescriptorType::eUniformBuffer,
+        .descriptorType     = vk::DescriptorType::eUniformBufferDynamic,
         .descriptorCount    = 1,
         .stageFlags         = vk::ShaderStageFlagBits::eFragment,
         .pImmutableSamplers = nullptr,
     };
 
-    vk::DescriptorSetLayoutBinding blinn_phong_bindings[] = { transform_binding, blinn_phong_binding };
+    vk::DescriptorSetLayoutBinding blinn_phong_bindings[] = { transform_binding, blinn_phong_binding, object_binding, visible_binding };
     vk::DescriptorSetLayoutCreateInfo blinn_phong_set_info{
-        .bindingCount   = 2,
+        .bindingCount   = 4,
         .pBindings      = blinn_phong_bindings,
     };
 
@@ -1380,11 +2071,108 @@ void Renderer::create_descriptors() {
         throw std::runtime_error("Failed to create descriptor set layout for textures");
     }
 
+    // objects, indirect commands, visible instances, the depth pyramid and
+    // the occlusion uniforms, see cull.comp
+    constexpr std::array<vk::DescriptorType, 5> cull_types = {
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eCombinedImageSampler,
+        vk::DescriptorType::eUniformBufferDynamic,
+    };
+
+    std::array<vk::DescriptorSetLayoutBinding, cull_types.size()> cull_bindings;
+    for (uint32_t binding = 0; binding < cull_bindings.size(); binding++) {
+        cull_bindings[binding] = vk::DescriptorSetLayoutBinding{
+            .binding            = binding,
+            .descriptorType     = cull_types[binding],
+            .descriptorCount    = 1,
+            .stageFlags         = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr,
+        };
+    }
+
+    vk::DescriptorSetLayoutCreateInfo cull_set_info{
+        .bindingCount       = static_cast<uint32_t>(cull_bindings.size()),
+        .pBindings          = cull_bindings.data(),
+    };
+
+    try {
+        m_cull_set_layout = m_device.get().createDescriptorSetLayout(cull_set_info);
+    } catch (const vk::SystemError &err) {
+        throw std::runtime_error("Failed to create descriptor set layout for culling");
+    }
+
+    // source level and destination level, see depth_reduce.comp
+    const std::array<vk::DescriptorSetLayoutBinding, 2> depth_pyramid_bindings = {
+        vk::DescriptorSetLayoutBinding{
+            .binding            = 0,
+            .descriptorType     = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount    = 1,
+            .stageFlags         = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr,
+        },
+        vk::DescriptorSetLayoutBinding{
+            .binding            = 1,
+            .descriptorType     = vk::DescriptorType::eStorageImage,
+            .descriptorCount    = 1,
+            .stageFlags         = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr,
+        },
+    };
+
+    vk::DescriptorSetLayoutCreateInfo depth_pyramid_set_info{
+        .bindingCount       = static_cast<uint32_t>(depth_pyramid_bindings.size()),
+        .pBindings          = depth_pyramid_bindings.data(),
+    };
+
+    try {
+        m_depth_pyramid_set_layout = m_device.get().createDescriptorSetLayout(depth_pyramid_set_info);
+    } catch (const vk::SystemError &err) {
+        throw std::runtime_error("Failed to create descriptor set layout for the depth pyramid");
+    }
+
+    // written by create_depth_pyramid, since the levels change with the swapchain
+    const std::vector<vk::DescriptorSetLayout> depth_pyramid_set_layouts(MAX_DEPTH_PYRAMID_LEVELS, m_depth_pyramid_set_layout);
+    vk::DescriptorSetAllocateInfo depth_pyramid_alloc_info{
+        .descriptorPool     = m_descriptor_pool,
+        .descriptorSetCount = MAX_DEPTH_PYRAMID_LEVELS,
+        .pSetLayouts        = depth_pyramid_set_layouts.data(),
+    };
+
+    try {
+        auto depth_pyramid_sets = m_device.get().allocateDescriptorSets(depth_pyramid_alloc_info);
+        std::copy(depth_pyramid_sets.begin(), depth_pyramid_sets.end(), m_depth_pyramid_sets);
+    } catch (const vk::SystemError &err) {
+        throw std::runtime_error("Failed to allocate descriptor set");
+    }
+
+    // every read is a texelFetch, the sampler only has to exist
+    try {
+        m_depth_pyramid_sampler = m_device.get().createSampler(
+            sampler_create_info(vk::Filter::eNearest, vk::SamplerAddressMode::eClampToEdge));
+    } catch (const vk::SystemError &err) {
+        throw std::runtime_error("Failed to create depth pyramid sampler");
+    }
+
+    void *uniform_ring_data;
+    VmaBuffer uniform_ring_buffer = create_mapped_buffer(UNIFORM_RING_REGION_SIZE * FRAMES_IN_FLIGHT,
+        vk::BufferUsageFlagBits::eUniformBuffer, &uniform_ring_data);
+    m_uniform_ring.init(uniform_ring_buffer, uniform_ring_data, UNIFORM_RING_REGION_SIZE, FRAMES_IN_FLIGHT,
+        m_device_properties.limits.minUniformBufferOffsetAlignment);
+
     for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
-        m_frames[i].transformations_buffer =
-            create_buffer(sizeof(Transformations), vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        m_frames[i].blinn_phong_buffer =
-            create_buffer(sizeof(BlinnPhong), vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        m_frames[i].object_capacity = INITIAL_OBJECT_CAPACITY;
+        m_frames[i].object_buffer =
+            create_mapped_buffer(INITIAL_OBJECT_CAPACITY * sizeof(GPUObject), vk::BufferUsageFlagBits::eStorageBuffer,
+                reinterpret_cast<void **>(&m_frames[i].objects));
+        m_frames[i].visible_buffer =
+            create_buffer(INITIAL_OBJECT_CAPACITY * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_GPU_ONLY);
+        m_frames[i].batch_capacity = INITIAL_BATCH_CAPACITY;
+        m_frames[i].indirect_buffer =
+            create_mapped_buffer(INITIAL_BATCH_CAPACITY * sizeof(vk::DrawIndexedIndirectCommand),
+                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                reinterpret_cast<void **>(&m_frames[i].commands));
 
         vk::DescriptorSetAllocateInfo alloc_info{
             .descriptorPool     = m_descriptor_pool,
@@ -1398,32 +2186,45 @@ void Renderer::create_descriptors() {
             .pSetLayouts        = &m_blinn_phong_set_layout,
         };
 
+        vk::DescriptorSetAllocateInfo cull_alloc_info{
+            .descriptorPool     = m_descriptor_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts        = &m_cull_set_layout,
+        };
+
         try {
             m_frames[i].parent_set = m_device.get().allocateDescriptorSets(alloc_info)[0];
             m_frames[i].parent_blinn_phong_set = m_device.get().allocateDescriptorSets(blinn_phong_alloc_info)[0];
+            m_frames[i].cull_set = m_device.get().allocateDescriptorSets(cull_alloc_info)[0];
         } catch (const vk::SystemError &err) {
             throw std::runtime_error("Failed to allocate descriptor set");
         }
 
         vk::DescriptorBufferInfo buffer_info{
-            .buffer = m_frames[i].transformations_buffer.buffer,
+            .buffer = m_uniform_ring.get_buffer().buffer,
             .offset = 0,
             .range  = sizeof(Transformations),
         };
 
         vk::DescriptorBufferInfo blinn_phong_buffer_info{
-            .buffer = m_frames[i].blinn_phong_buffer.buffer,
+            .buffer = m_uniform_ring.get_buffer().buffer,
             .offset = 0,
             .range  = sizeof(BlinnPhong),
         };
 
-        std::array<vk::WriteDescriptorSet, 3> set_writes{
+        vk::DescriptorBufferInfo occlusion_buffer_info{
+            .buffer = m_uniform_ring.get_buffer().buffer,
+            .offset = 0,
+            .range  = sizeof(OcclusionConstants),
+        };
+
+        std::array<vk::WriteDescriptorSet, 4> set_writes{
             vk::WriteDescriptorSet{
                 .dstSet             = m_frames[i].parent_set,
                 .dstBinding         = 0,
                 .dstArrayElement    = 0,
                 .descriptorCount    = 1,
-                .descriptorType     = vk::DescriptorType::eUniformBuffer,
+                .descriptorType     = vk::DescriptorType::eUniformBufferDynamic,
                 .pImageInfo         = nullptr,
                 .pBufferInfo        = &buffer_info,
                 .pTexelBufferView   = nullptr,
@@ -1433,7 +2234,7 @@ void Renderer::create_descriptors() {
                 .dstBinding         = 0,
                 .dstArrayElement    = 0,
                 .descriptorCount    = 1,
-                .descriptorType     = vk::DescriptorType::eUniformBuffer,
+                .descriptorType     = vk::DescriptorType::eUniformBufferDynamic,
                 .pImageInfo         = nullptr,
                 .pBufferInfo        = &buffer_info,
                 .pTexelBufferView   = nullptr,
@@ -1443,14 +2244,25 @@ void Renderer::create_descriptors() {
                 .dstBinding         = 1,
                 .dstArrayElement    = 0,
                 .descriptorCount    = 1,
-                .descriptorType     = vk::DescriptorType::eUniformBuffer,
+                .descriptorType     = vk::DescriptorType::eUniformBufferDynamic,
                 .pImageInfo         = nullptr,
                 .pBufferInfo        = &blinn_phong_buffer_info,
                 .pTexelBufferView   = nullptr,
             },
+            vk::WriteDescriptorSet{
+                .dstSet             = m_frames[i].cull_set,
+                .dstBinding         = 4,
+                .dstArrayElement    = 0,
+                .descriptorCount    = 1,
+                .descriptorType     = vk::DescriptorType::eUniformBufferDynamic,
+                .pImageInfo         = nullptr,
+                .pBufferInfo        = &occlusion_buffer_info,
+                .pTexelBufferView   = nullptr,
+            },
         };
 
         m_device.get().updateDescriptorSets(set_writes, 0);
+        write_draw_descriptors(m_frames[i]);
     }
 
     m_deletion_queue.enqueue([&]() {
@@ -1458,11 +2270,17 @@ void Renderer::create_descriptors() {
         m_device.get().destroyDescriptorSetLayout(m_textures_set_layout);
         m_device.get().destroyDescriptorSetLayout(m_blinn_phong_set_layout);
         m_device.get().destroyDescriptorSetLayout(m_skybox_set_layout);
+        m_device.get().destroyDescriptorSetLayout(m_cull_set_layout);
+        m_device.get().destroyDescriptorSetLayout(m_depth_pyramid_set_layout);
         m_device.get().destroyDescriptorPool(m_descriptor_pool);
+        m_device.get().destroySampler(m_depth_pyramid_sampler);
+
+        vmaDestroyBuffer(m_allocator, m_uniform_ring.get_buffer().buffer, m_uniform_ring.get_buffer().allocation);
 
         for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
-            vmaDestroyBuffer(m_allocator, m_frames[i].transformations_buffer.buffer, m_frames[i].transformations_buffer.allocation);
-            vmaDestroyBuffer(m_allocator, m_frames[i].blinn_phong_buffer.buffer, m_frames[i].blinn_phong_buffer.allocation);
+            vmaDestroyBuffer(m_allocator, m_frames[i].object_buffer.buffer, m_frames[i].object_buffer.allocation);
+            vmaDestroyBuffer(m_allocator, m_frames[i].visible_buffer.buffer, m_frames[i].visible_buffer.allocation);
+            vmaDestroyBuffer(m_allocator, m_frames[i].indirect_buffer.buffer, m_frames[i].indirect_buffer.allocation);
         }
     });
 }
@@ -1482,6 +2300,9 @@ void Renderer::create_pipelines() {
     vk::ShaderModule untextured_blinn_phong_vert    = load_shader("shaders/out/untextured_blinn_phong.vert.spv");
     vk::ShaderModule skybox_frag                    = load_shader("shaders/out/skybox.frag.spv");
     vk::ShaderModule skybox_vert                    = load_shader("shaders/out/skybox.vert.spv");
+    vk::ShaderModule cull_comp                      = load_shader("shaders/out/cull.comp.spv");
+    vk::ShaderModule depth_reduce_comp              = load_shader("shaders/out/depth_reduce.comp.spv");
+    vk::ShaderModule depth_resolve_comp             = load_shader("shaders/out/depth_resolve.comp.spv");
 
     PipelineContext pipeline_ctx;
 
@@ -1701,6 +2522,77 @@ void Renderer::create_pipelines() {
         m_skybox_pipeline_layout = skybox_pipeline_layout;
     }
 
+    // CULLING PIPELINE
+    {
+        vk::PushConstantRange cull_constants{
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .offset     = 0,
+            .size       = sizeof(CullConstants),
+        };
+
+        vk::PipelineLayoutCreateInfo cull_layout_info = pipeline_layout_create_info();
+        cull_layout_info.setLayoutCount = 1;
+        cull_layout_info.pSetLayouts = &m_cull_set_layout;
+        cull_layout_info.pushConstantRangeCount = 1;
+        cull_layout_info.pPushConstantRanges = &cull_constants;
+
+        try {
+            m_cull_pipeline_layout = m_device.get().createPipelineLayout(cull_layout_info);
+        } catch (const vk::SystemError &err) {
+            throw std::runtime_error("Failed to create culling pipeline layout");
+        }
+
+        vk::ComputePipelineCreateInfo cull_pipeline_info{
+            .stage  = pipeline_shader_stage_create_info(vk::ShaderStageFlagBits::eCompute, cull_comp),
+            .layout = m_cull_pipeline_layout,
+        };
+
+        try {
+            m_cull_pipeline = m_device.get().createComputePipeline(nullptr, cull_pipeline_info).value;
+        } catch (const vk::SystemError &err) {
+            throw std::runtime_error("Failed to create culling pipeline");
+        }
+    }
+
+    // DEPTH PYRAMID PIPELINES
+    {
+        vk::PushConstantRange depth_pyramid_constants{
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .offset     = 0,
+            .size       = sizeof(DepthPyramidConstants),
+        };
+
+        vk::PipelineLayoutCreateInfo depth_pyramid_layout_info = pipeline_layout_create_info();
+        depth_pyramid_layout_info.setLayoutCount = 1;
+        depth_pyramid_layout_info.pSetLayouts = &m_depth_pyramid_set_layout;
+        depth_pyramid_layout_info.pushConstantRangeCount = 1;
+        depth_pyramid_layout_info.pPushConstantRanges = &depth_pyramid_constants;
+
+        try {
+            m_depth_pyramid_pipeline_layout = m_device.get().createPipelineLayout(depth_pyramid_layout_info);
+        } catch (const vk::SystemError &err) {
+            throw std::runtime_error("Failed to create depth pyramid pipeline layout");
+        }
+
+        vk::ComputePipelineCreateInfo depth_reduce_pipeline_info{
+            .stage  = pipeline_shader_stage_create_info(vk::ShaderStageFlagBits::eCompute, depth_reduce_comp),
+            .layout = m_depth_pyramid_pipeline_layout,
+        };
+
+        // level 0 from a multisampled depth image
+        vk::ComputePipelineCreateInfo depth_resolve_pipeline_info{
+            .stage  = pipeline_shader_stage_create_info(vk::ShaderStageFlagBits::eCompute, depth_resolve_comp),
+            .layout = m_depth_pyramid_pipeline_layout,
+        };
+
+        try {
+            m_depth_reduce_pipeline = m_device.get().createComputePipeline(nullptr, depth_reduce_pipeline_info).value;
+            m_depth_resolve_pipeline = m_device.get().createComputePipeline(nullptr, depth_resolve_pipeline_info).value;
+        } catch (const vk::SystemError &err) {
+            throw std::runtime_error("Failed to create depth pyramid pipelines");
+        }
+    }
+
     m_deletion_queue.enqueue([=]() {
         m_device.get().destroyPipeline(untextured_pipeline);
         m_device.get().destroyPipeline(textured_pipeline);
@@ -1708,12 +2600,17 @@ void Renderer::create_pipelines() {
         m_device.get().destroyPipeline(untextured_blinn_phong_pipeline);
         m_device.get().destroyPipeline(textured_blinn_phong_pipeline);
         m_device.get().destroyPipeline(skybox_pipeline);
+        m_device.get().destroyPipeline(m_cull_pipeline);
+        m_device.get().destroyPipeline(m_depth_reduce_pipeline);
+        m_device.get().destroyPipeline(m_depth_resolve_pipeline);
         m_device.get().destroyPipelineLayout(untextured_pipeline_layout);
         m_device.get().destroyPipelineLayout(textured_pipeline_layout);
         m_device.get().destroyPipelineLayout(bounding_box_pipeline_layout);
         m_device.get().destroyPipelineLayout(untextured_blinn_phong_pipeline_layout);
         m_device.get().destroyPipelineLayout(textured_blinn_phong_pipeline_layout);
         m_device.get().destroyPipelineLayout(skybox_pipeline_layout);
+        m_device.get().destroyPipelineLayout(m_cull_pipeline_layout);
+        m_device.get().destroyPipelineLayout(m_depth_pyramid_pipeline_layout);
     });
 
     m_device.get().destroyShaderModule(untextured_frag);
@@ -1728,6 +2625,9 @@ void Renderer::create_pipelines() {
     m_device.get().destroyShaderModule(textured_blinn_phong_vert);
     m_device.get().destroyShaderModule(skybox_frag);
     m_device.get().destroyShaderModule(skybox_vert);
+    m_device.get().destroyShaderModule(cull_comp);
+    m_device.get().destroyShaderModule(depth_reduce_comp);
+    m_device.get().destroyShaderModule(depth_resolve_comp);
 }
 
 void Renderer::immediate_command(std::function<void(vk::CommandBuffer cmd)> &&function) {
@@ -0,0 +1,333 @@
+#include "boa/gfx/scene_index.h"
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace boa::gfx {
+
+SceneIndex *scene_index_instance = nullptr;
+
+SceneIndex::SceneIndex() {
+    if (!scene_index_instance)
+        scene_index_instance = this;
+}
+
+SceneIndex::~SceneIndex() {
+    if (scene_index_instance == this)
+        scene_index_instance = nullptr;
+}
+
+SceneIndex &SceneIndex::get() {
+    if (!scene_index_instance)
+        throw std::runtime_error("Attempted to get SceneIndex before construction");
+    return *scene_index_instance;
+}
+
+uint32_t SceneIndex::insert(uint32_t e_id, const Box &box) {
+    uint32_t leaf = allocate_node();
+    Node &node = m_nodes[leaf];
+    node.tight_box = box;
+    node.box = Box{ box.min - glm::vec3(BOX_MARGIN), box.max + glm::vec3(BOX_MARGIN) };
+    node.e_id = e_id;
+
+    insert_leaf(leaf);
+    m_leaf_count++;
+    m_changes++;
+    return leaf;
+}
+
+void SceneIndex::move(uint32_t proxy, const Box &box) {
+    Node &node = m_nodes[proxy];
+    node.tight_box = box;
+    if (encloses(node.box, box))
+        return;
+
+    node.box = Box{ box.min - glm::vec3(BOX_MARGIN), box.max + glm::vec3(BOX_MARGIN) };
+    refit_from(node.parent);
+    m_changes++;
+}
+
+void SceneIndex::remove(uint32_t proxy) {
+    remove_leaf(proxy);
+    free_node(proxy);
+    m_leaf_count--;
+}
+
+void SceneIndex::clear() {
+    m_nodes.clear();
+    m_root = NO_NODE;
+    m_free_head = NO_NODE;
+    m_leaf_count = 0;
+    m_changes = 0;
+    m_rebuilt_cost = 0.0f;
+}
+
+void SceneIndex::rebuild_if_degraded() {
+    // the cost is a walk over every node, so it is only looked at once a
+    // fair share of the leaves changed
+    if (m_changes == 0 || m_changes < m_leaf_count / 4)
+        return;
+
+    m_changes = 0;
+    if (cost() > m_rebuilt_cost * REBUILD_COST_RATIO)
+        rebuild();
+}
+
+void SceneIndex::rebuild() {
+    std::vector<uint32_t> leaves;
+    leaves.reserve(m_leaf_count);
+
+    // leaves keep their index, it is the proxy entities hold on to
+    for (uint32_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i].e_id != NO_ENTITY)
+            leaves.push_back(i);
+        else if (!m_nodes[i].is_leaf())
+            free_node(i);
+    }
+
+    m_root = leaves.empty() ? NO_NODE : build(leaves, 0, leaves.size());
+    if (m_root != NO_NODE)
+        m_nodes[m_root].parent = NO_NODE;
+
+    m_changes = 0;
+    m_rebuilt_cost = cost();
+}
+
+void SceneIndex::cull(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    constexpr uint32_t ALL_PLANES = (1u << 6) - 1;
+
+    if (m_root == NO_NODE)
+        return;
+
+    // planes a node still has to be tested against travel with it
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.emplace_back(m_root, ALL_PLANES);
+
+    while (!stack.empty()) {
+        auto [node_idx, planes] = stack.back();
+        stack.pop_back();
+        const Node &node = m_nodes[node_idx];
+
+        glm::vec3 center = node.box.center();
+        glm::vec3 extent = (node.box.max - node.box.min) * 0.5f;
+
+        bool outside = false;
+        for (uint32_t i = 0; i < frustum.planes.size() && !outside; i++) {
+            if (!(planes & (1u << i)))
+                continue;
+
+            const glm::vec4 &plane = frustum.planes[i];
+            float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+            float reach = glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if (distance <= -reach)
+                outside = true;
+            else if (distance >= reach)
+                planes &= ~(1u << i);
+        }
+
+        if (outside)
+            continue;
+
+        if (node.is_leaf()) {
+            visible.push_back(node.e_id);
+            continue;
+        }
+
+        stack.emplace_back(node.right, planes);
+        stack.emplace_back(node.left, planes);
+    }
+}
+
+uint32_t SceneIndex::allocate_node() {
+    if (m_free_head == NO_NODE) {
+        m_nodes.emplace_back();
+        return m_nodes.size() - 1;
+    }
+
+    uint32_t node = m_free_head;
+    m_free_head = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+    return node;
+}
+
+void SceneIndex::free_node(uint32_t node) {
+    m_nodes[node] = Node{};
+    m_nodes[node].parent = m_free_head;
+    m_free_head = node;
+}
+
+// Walks down to the sibling where the leaf adds the least area, as in
+// Box2D's b2DynamicTree: stop here when pairing with this node is cheaper
+// than the area descending into either child would add.
+void SceneIndex::insert_leaf(uint32_t leaf) {
+    if (m_root == NO_NODE) {
+        m_root = leaf;
+        m_nodes[leaf].parent = NO_NODE;
+        return;
+    }
+
+    const Box leaf_box = m_nodes[leaf].box;
+    uint32_t sibling = m_root;
+    while (!m_nodes[sibling].is_leaf()) {
+        const Node &node = m_nodes[sibling];
+        float combined_area = area(merge(node.box, leaf_box));
+        float pair_cost = 2.0f * combined_area;
+        // every ancestor grows by this much if the leaf goes further down
+        float inherited_cost = 2.0f * (combined_area - area(node.box));
+
+        const auto descend_cost = [&](uint32_t child) {
+            const Box &child_box = m_nodes[child].box;
+            float merged = area(merge(child_box, leaf_box));
+            return (m_nodes[child].is_leaf() ? merged : merged - area(child_box)) + inherited_cost;
+        };
+
+        float left_cost = descend_cost(node.left);
+        float right_cost = descend_cost(node.right);
+        if (pair_cost < left_cost && pair_cost < right_cost)
+            break;
+
+        sibling = left_cost < right_cost ? node.left : node.right;
+    }
+
+    uint32_t old_parent = m_nodes[sibling].parent;
+    uint32_t new_parent = allocate_node();
+    m_nodes[new_parent].parent = old_parent;
+    m_nodes[new_parent].left = sibling;
+    m_nodes[new_parent].right = leaf;
+    m_nodes[new_parent].box = merge(m_nodes[sibling].box, leaf_box);
+    m_nodes[sibling].parent = new_parent;
+    m_nodes[leaf].parent = new_parent;
+
+    if (old_parent == NO_NODE) {
+        m_root = new_parent;
+    } else {
+        Node &grandparent = m_nodes[old_parent];
+        (grandparent.left == sibling ? grandparent.left : grandparent.right) = new_parent;
+        refit_from(old_parent);
+    }
+}
+
+void SceneIndex::remove_leaf(uint32_t leaf) {
+    if (leaf == m_root) {
+        m_root = NO_NODE;
+        return;
+    }
+
+    uint32_t parent = m_nodes[leaf].parent;
+    uint32_t grandparent = m_nodes[parent].parent;
+    uint32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+    m_nodes[sibling].parent = grandparent;
+    free_node(parent);
+
+    if (grandparent == NO_NODE) {
+        m_root = sibling;
+    } else {
+        Node &node = m_nodes[grandparent];
+        (node.left == parent ? node.left : node.right) = sibling;
+        refit_from(grandparent);
+    }
+}
+
+void SceneIndex::refit_from(uint32_t node) {
+    for (; node != NO_NODE; node = m_nodes[node].parent)
+        m_nodes[node].box = merge(m_nodes[m_nodes[node].left].box, m_nodes[m_nodes[node].right].box);
+}
+
+// Top down binned SAH over leaves[begin, end): centroids are binned along
+// the widest axis and the split between bins with the lowest
+// area * count on both sides wins.
+uint32_t SceneIndex::build(std::vector<uint32_t> &leaves, uint32_t begin, uint32_t end) {
+    if (end - begin == 1)
+        return leaves[begin];
+
+    Box centroid_bounds{ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (uint32_t i = begin; i < end; i++) {
+        glm::vec3 centroid = m_nodes[leaves[i]].box.center();
+        centroid_bounds.min = glm::min(centroid_bounds.min, centroid);
+        centroid_bounds.max = glm::max(centroid_bounds.max, centroid);
+    }
+
+    glm::vec3 size = centroid_bounds.max - centroid_bounds.min;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+    uint32_t middle = begin + (end - begin) / 2;
+    if (size[axis] > 0.0f) {
+        const float scale = SAH_BIN_COUNT / size[axis];
+        const auto bin_of = [&](uint32_t leaf) {
+            float offset = m_nodes[leaf].box.center()[axis] - centroid_bounds.min[axis];
+            return std::min(static_cast<uint32_t>(offset * scale), SAH_BIN_COUNT - 1);
+        };
+
+        std::array<Box, SAH_BIN_COUNT> bin_boxes;
+        std::array<uint32_t, SAH_BIN_COUNT> bin_counts{};
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t bin = bin_of(leaves[i]);
+            bin_boxes[bin] = bin_counts[bin] ? merge(bin_boxes[bin], m_nodes[leaves[i]].box) : m_nodes[leaves[i]].box;
+            bin_counts[bin]++;
+        }
+
+        // right_costs[i] is the cost of bins [i, SAH_BIN_COUNT)
+        std::array<float, SAH_BIN_COUNT> right_costs{};
+        Box right_box;
+        uint32_t right_count = 0;
+        for (uint32_t bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+            if (bin_counts[bin]) {
+                right_box = right_count ? merge(right_box, bin_boxes[bin]) : bin_boxes[bin];
+                right_count += bin_counts[bin];
+            }
+            right_costs[bin] = right_count ? area(right_box) * right_count : 0.0f;
+        }
+
+        float best_cost = std::numeric_limits<float>::max();
+        uint32_t best_split = 0;
+        Box left_box;
+        uint32_t left_count = 0;
+        for (uint32_t split = 1; split < SAH_BIN_COUNT; split++) {
+            if (bin_counts[split - 1]) {
+                left_box = left_count ? merge(left_box, bin_boxes[split - 1]) : bin_boxes[split - 1];
+                left_count += bin_counts[split - 1];
+            }
+
+            if (left_count == 0 || left_count == end - begin)
+                continue;
+
+            float split_cost = area(left_box) * left_count + right_costs[split];
+            if (split_cost < best_cost) {
+                best_cost = split_cost;
+                best_split = split;
+            }
+        }
+
+        if (best_split != 0) {
+            auto split_at = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](uint32_t leaf) {
+                return bin_of(leaf) < best_split;
+            });
+            middle = split_at - leaves.begin();
+        }
+    }
+
+    uint32_t left = build(leaves, begin, middle);
+    uint32_t right = build(leaves, middle, end);
+
+    uint32_t node = allocate_node();
+    m_nodes[node].left = left;
+    m_nodes[node].right = right;
+    m_nodes[node].box = merge(m_nodes[left].box, m_nodes[right].box);
+    m_nodes[left].parent = node;
+    m_nodes[right].parent = node;
+    return node;
+}
+
+// sum of the internal nodes' areas, what a query pays for descending
+float SceneIndex::cost() const {
+    float total = 0.0f;
+    for (const Node &node : m_nodes) {
+        if (!node.is_leaf())
+            total += area(node.box);
+    }
+    return total;
+}
+
+}
@@ -16,7 +16,8 @@
 namespace boa::ngn {
 
 Engine::Engine(const std::string &default_path)
-    : renderer(),
+    : command_queue(thread_pool.thread_count()),
+      renderer(),
       window(renderer.get_window()),
       camera(renderer.get_camera()),
       keyboard(renderer.get_keyboard()),
@@ -27,9 +28,18 @@ Engine::Engine(const std::string &default_path)
 {
     LOG_INFO("(Engine) Initializing with world file '{}'", default_path);
 
+    component_store.register_serializer<LoadedAsset>(
+        [](const LoadedAsset &loaded_asset, boa::ecs::SnapshotWriter &writer) {
+            writer.write_string(loaded_asset.resource_path);
+        },
+        [](boa::ecs::SnapshotReader &reader) {
+            return LoadedAsset(reader.read_string());
+        });
+
     physics_controller.enable_debug_drawing(renderer);
     physics_controller.set_entity_deletion_cutoff(1000.0f);
     setup_input();
+    setup_systems();
 
     m_state.load_from_json(default_path.c_str());
     m_state.add_entities(asset_manager, animation_controller, physics_controller);
@@ -79,20 +89,7 @@ void Engine::main_loop() {
             std::chrono::duration<float, std::chrono::seconds::period>(current_time - last_time).count();
         last_time = current_time;
 
-        draw_engine_interface();
-
-        animation_controller.update(time_change);
-        physics_controller.update(time_change);
-
-        if (m_ui_state.show_physics_bounding_boxes) {
-            physics_controller.debug_reset();
-            physics_controller.debug_draw();
-        }
-
-        renderer.draw_frame();
-
-        time_change *= 60.0f;
-        input_update(time_change);
+        system_scheduler.run(time_change);
 
 #ifdef BENCHMARK
         if (renderer.get_frame_count() == BENCHMARK_FRAME_COUNT)
@@ -110,6 +107,58 @@ void Engine::main_loop() {
     renderer.wait_idle();
 }
 
+void Engine::setup_systems() {
+    using boa::ecs::SystemAccess;
+
+    // registration order is the execution order for systems that conflict
+    system_scheduler.add_system("Interface", SystemAccess().exclusive(), [&](float) {
+        draw_engine_interface();
+    });
+
+    // Animation and Physics run at the same time, so the views they iterate
+    // are made here, creating one while the other system looks is a race
+    system_scheduler.add_system("Animation", SystemAccess().write<boa::gfx::Animated>(), [&](float time_change) {
+        animation_controller.update(time_change);
+    });
+    entity_group.view<boa::gfx::Animated>();
+
+    system_scheduler.add_system("Physics",
+        SystemAccess().read<boa::gfx::Renderable>().write<boa::phy::Physical, boa::gfx::Transformable>(),
+        [&](float time_change) {
+            physics_controller.update(time_change);
+        });
+    entity_group.view<boa::phy::Physical, boa::gfx::Transformable, boa::gfx::Renderable>();
+
+    // exclusive since it advances the store version, which nothing may do
+    // while other systems stamp components; the pass itself is parallel
+    system_scheduler.add_system("Transforms", SystemAccess().exclusive(),
+        [&, since_version = uint32_t(0)](float) mutable {
+            boa::gfx::Transformable::update_changed(component_store.get_pool<boa::gfx::Transformable>(), since_version);
+            boa::gfx::Transformable::update_hierarchy(entity_group, since_version);
+            since_version = component_store.advance_version();
+        });
+
+    // structural changes recorded by the systems above land here
+    system_scheduler.add_system("Commands", SystemAccess().exclusive(), [&](float) {
+        command_queue.flush(entity_group);
+    });
+
+    system_scheduler.add_system("Physics Debug", SystemAccess().exclusive(), [&](float) {
+        if (m_ui_state.show_physics_bounding_boxes) {
+            physics_controller.debug_reset();
+            physics_controller.debug_draw();
+        }
+    });
+
+    system_scheduler.add_system("Render", SystemAccess().exclusive(), [&](float) {
+        renderer.draw_frame();
+    });
+
+    system_scheduler.add_system("Input", SystemAccess().exclusive(), [&](float time_change) {
+        input_update(time_change * 60.0f);
+    });
+}
+
 void Engine::deselect_object() {
     if (last_selected_entity.has_value()) {
         auto &ngn_config = entity_group.get_component<EngineSelectable>(last_selected_entity.value());
@@ -119,8 +168,8 @@ void Engine::deselect_object() {
 }
 
 void Engine::delete_entity(uint32_t e_id) {
-    if (entity_group.has_component<boa::phy::Physical>(e_id))
-        physics_controller.remove_entity(e_id);
+    // descendants may have bodies even when `e_id` has none
+    physics_controller.remove_entity(e_id);
 
     if (entity_group.has_component<boa::gfx::BaseRenderable>(e_id)) {
         entity_group.disable<boa::gfx::Renderable>(e_id);
@@ -202,9 +251,9 @@ void Engine::setup_input() {
                 if (!last_selected_entity.has_value())
                     return;
 
-                for (size_t i = 1; i < 300; i++) {
-                    uint32_t entity_copy =
-                        entity_group.copy_entity<boa::gfx::Renderable>(last_selected_entity.value());
+                // only the model, the rest is set up per copy below
+                entity_group.instantiate<boa::gfx::Renderable>(last_selected_entity.value(), 299, [&](uint32_t entity_copy, uint32_t copy_idx) {
+                    size_t i = copy_idx + 1;
 
                     entity_group.enable_and_make<boa::gfx::Transformable>(entity_copy,
                         glm::quat{ 0.0f, 0.0f, 1.0f, 0.0f },
@@ -213,7 +262,7 @@ void Engine::setup_input() {
                     entity_group.enable_and_make<EngineSelectable>(entity_copy);
 
                     physics_controller.add_entity(entity_copy, i * 20.0f + 30.0f);
-                }
+                });
 
                 deselect_object();
                 break;
@@ -226,7 +275,28 @@ void Engine::setup_input() {
                 if (physics_controller.is_physics_enabled()) {
                     physics_controller.disable_physics();
                     m_mode = EngineMode::Edit;
+
+                    // roll the world back to where the simulation started
+                    if (!m_physics_snapshot.empty()) {
+                        physics_controller.remove_all_entities();
+                        last_selected_entity.reset();
+                        // a failed restore leaves the world empty, with no bodies to restore
+                        try {
+                            entity_group.restore(m_physics_snapshot);
+                            physics_controller.restore_bodies();
+                        } catch (const std::runtime_error &err) {
+                            LOG_WARN("(Engine) Failed to roll back world after physics, it was cleared: {}", err.what());
+                            physics_controller.clear_pending_bodies();
+                        }
+                    }
                 } else {
+                    deselect_object();
+                    try {
+                        entity_group.snapshot(m_physics_snapshot);
+                    } catch (const std::runtime_error &err) {
+                        LOG_WARN("(Engine) Failed to snapshot world, physics will not be rolled back: {}", err.what());
+                        m_physics_snapshot.data.clear();
+                    }
                     physics_controller.enable_physics();
                     m_mode = EngineMode::Physics;
                 }
@@ -247,14 +317,9 @@ void Engine::setup_input() {
             deselect_object();
 
             glm::dvec2 mouse_position = mouse.get_position();
-            auto hit = physics_controller.raycast_cursor_position(
-                renderer.get_width(), renderer.get_height(),
-                (uint32_t)mouse_position.x, (uint32_t)mouse_position.y,
-                renderer.get_view_projection(),
-                1000.0f);
+            auto hit = renderer.pick_entity((uint32_t)mouse_position.x, (uint32_t)mouse_position.y, 1000.0f);
 
             if (hit.has_value() && entity_group.has_component<EngineSelectable>(hit.value())) {
-                auto &physical = entity_group.get_component<boa::phy::Physical>(hit.value());
                 auto &ngn_config = entity_group.get_component<EngineSelectable>(hit.value());
                 ngn_config.selected = true;
                 last_selected_entity = hit.value();
@@ -40,7 +40,7 @@ void EngineState::save_to_json(boa::gfx::AssetManager &asset_manager,
     std::unordered_map<uint32_t, uint32_t> model_id_to_object_index;
     entity_group.for_each_entity_with_component<boa::gfx::Renderable>([&](uint32_t e_id) {
         auto &renderable = entity_group.get_component<boa::gfx::Renderable>(e_id);
-        auto &transform = entity_group.get_component<boa::gfx::Transformable>(e_id);
+        auto transform = entity_group.get_component<boa::gfx::Transformable>(e_id);
         auto &loaded_asset = entity_group.get_component<boa::ngn::LoadedAsset>(e_id);
         auto &renderable_model = asset_manager.get_model(renderable.model_id);
 
@@ -76,37 +76,24 @@ void Engine::draw_toolbox() {
     if (ImGui::RadioButton("Scale", current_tool == ImGuizmo::SCALE))
         current_tool = ImGuizmo::SCALE;
 
-    auto &transformable = entity_group.get_component<boa::gfx::Transformable>(selected_entity);
-    float *transform_matrix = glm::value_ptr(transformable.transform_matrix);
-    float *current_translation = glm::value_ptr(transformable.translation);
-    float *current_scale = glm::value_ptr(transformable.scale);
-
-    float current_rotation[3] = {
-        glm::degrees(glm::yaw(transformable.orientation)),
-        glm::degrees(glm::pitch(transformable.orientation)),
-        glm::degrees(glm::roll(transformable.orientation)),
-    };
+    // edited on a copy, the non-const get_component marks the entity
+    // changed, which only a real edit should
+    glm::mat4 edited_matrix = std::as_const(entity_group).get_component<boa::gfx::Transformable>(selected_entity).transform_matrix;
+    float *transform_matrix = glm::value_ptr(edited_matrix);
 
+    float current_translation[3], current_rotation[3], current_scale[3];
     ImGuizmo::DecomposeMatrixToComponents(transform_matrix, current_translation, current_rotation, current_scale);
 
-    ImGui::InputFloat3("T", current_translation);
-    ImGui::InputFloat3("R", current_rotation);
-    ImGui::InputFloat3("S", current_scale);
-
-    transformable.scale = glm::vec3(std::max(0.001f, transformable.scale.x),
-                                    std::max(0.001f, transformable.scale.y),
-                                    std::max(0.001f, transformable.scale.z));
-
-    ImGuizmo::RecomposeMatrixFromComponents(current_translation, current_rotation, current_scale, transform_matrix);
+    bool edited = false;
+    edited |= ImGui::InputFloat3("T", current_translation);
+    edited |= ImGui::InputFloat3("R", current_rotation);
+    edited |= ImGui::InputFloat3("S", current_scale);
 
-    /*transformable.orientation = glm::quat(glm::vec3(glm::radians(current_rotation[2]),
-                                                    glm::radians(current_rotation[0]),
-                                                    glm::radians(current_rotation[1])));*/
-    transformable.orientation = glm::quat(glm::vec3(glm::radians(current_rotation[0]),
-                                                    glm::radians(current_rotation[1]),
-                                                    glm::radians(current_rotation[2])));
-
-    physics_controller.sync_physics_transform(selected_entity);
+    if (edited) {
+        for (float &scale : current_scale)
+            scale = std::max(0.001f, scale);
+        ImGuizmo::RecomposeMatrixFromComponents(current_translation, current_rotation, current_scale, transform_matrix);
+    }
 
     static bool use_snap(false);
     ImGui::Checkbox("Use snapping", &use_snap);
@@ -153,9 +140,31 @@ void Engine::draw_toolbox() {
                              ImVec2(128, 128),
                              0x10101010);*/
 
-    ImGuizmo::Manipulate(view_m_raw,
-                         projection_m_raw,
-                         current_tool, ImGuizmo::WORLD, transform_matrix, NULL, use_snap ? snap : NULL);
+    edited |= ImGuizmo::Manipulate(view_m_raw,
+                                   projection_m_raw,
+                                   current_tool, ImGuizmo::WORLD, transform_matrix, NULL, use_snap ? snap : NULL);
+
+    // writing back untouched values would only add float drift to the TRS
+    if (edited) {
+        // matrices are recomposed from TRS after physics, keep them in sync;
+        // children keep TRS relative to their parent
+        glm::mat4 local_matrix = edited_matrix;
+        if (entity_group.has_component<boa::ecs::Parent>(selected_entity)) {
+            uint32_t parent_e_id = std::as_const(entity_group).get_component<boa::ecs::Parent>(selected_entity).e_id;
+            if (entity_group.has_component<boa::gfx::Transformable>(parent_e_id)) {
+                const auto &parent_matrix = std::as_const(entity_group).get_component<boa::gfx::Transformable>(parent_e_id).transform_matrix;
+                local_matrix = glm::inverse(parent_matrix) * edited_matrix;
+            }
+        }
+
+        auto transformable = entity_group.get_component<boa::gfx::Transformable>(selected_entity);
+        transformable.transform_matrix = local_matrix;
+        transformable.decompose();
+        // physics wants the world matrix, the Transforms system would only
+        // put it back next frame
+        transformable.transform_matrix = edited_matrix;
+        physics_controller.sync_physics_transform(selected_entity);
+    }
 
     ImGui::LabelText("", "Currently Selected: %d", last_selected_entity.value());
 }
@@ -283,6 +292,7 @@ void Engine::draw_main_menu_bar() {
             m_state.load_from_json(FileDialog::get().get_selected_path().c_str());
             asset_manager.reset();
             entity_group.clear_entities();
+            m_physics_snapshot.data.clear();
             m_state.add_entities(asset_manager, animation_controller, physics_controller);
             m_dialog_shown = DialogShown::None;
         } catch (const std::runtime_error &err) {
@@ -403,7 +413,7 @@ void Engine::draw_entity_create_window() {
         auto &base_renderable = entity_group.get_component<boa::gfx::BaseRenderable>(current_entity.value());
         auto &loaded_asset = entity_group.get_component<boa::ngn::LoadedAsset>(current_entity.value());
 
-        uint32_t new_entity = entity_group.copy_entity<boa::ngn::LoadedAsset, boa::gfx::Animated>(current_entity.value());
+        uint32_t new_entity = entity_group.copy_entity(current_entity.value());
         entity_group.enable_and_make<boa::gfx::Renderable>(new_entity, base_renderable.model_id);
         entity_group.enable_and_make<boa::ngn::EngineSelectable>(new_entity, false);
 
@@ -453,6 +463,29 @@ void Engine::draw_statistics_window() const {
     ImGui::PlotLines("FPS", fps_samples, IM_ARRAYSIZE(fps_samples), offset, overlay, -1.0f, 1.0f, ImVec2(0, 40.0f));
     ImGui::LabelText(std::to_string(entity_group.size()).c_str(), "Entity Count");
 
+    // issued against requested, the difference is what state sorting saved
+    const auto &render_statistics = renderer.get_render_statistics();
+    const auto bind_label = [](const boa::gfx::RenderStatistics::Count &count, const char *name) {
+        ImGui::LabelText(fmt::format("{} / {}", count.issued, count.requested).c_str(), "%s", name);
+    };
+
+    ImGui::Separator();
+    ImGui::LabelText(fmt::format("{} / {}", render_statistics.draw_calls, render_statistics.draws).c_str(), "Draw Calls / Draws");
+    ImGui::LabelText(std::to_string(render_statistics.command_buffers).c_str(), "Command Buffers");
+    ImGui::LabelText(fmt::format("{} / {}", render_statistics.triangles, render_statistics.full_detail_triangles).c_str(),
+        "Triangles / Full Detail");
+    ImGui::LabelText(std::to_string(render_statistics.full_detail_triangles - render_statistics.triangles).c_str(),
+        "Triangles Saved by LOD");
+    bind_label(render_statistics.pipeline_binds, "Pipeline Binds");
+    bind_label(render_statistics.descriptor_binds, "Descriptor Binds");
+    bind_label(render_statistics.vertex_buffer_binds, "Vertex Buffer Binds");
+    bind_label(render_statistics.index_buffer_binds, "Index Buffer Binds");
+    bind_label(render_statistics.push_constants, "Push Constants");
+
+    ImGui::Separator();
+    for (const auto &timing : system_scheduler.get_timings())
+        ImGui::LabelText(fmt::format("{:.3f} ms", timing.milliseconds).c_str(), "%s", timing.name.c_str());
+
     ImGui::End();
 }
 
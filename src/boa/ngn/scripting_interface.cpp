@@ -1,6 +1,7 @@
 #include "boa/ngn/scripting_interface.h"
 #include "boa/ecs/ecs.h"
 #include "boa/gfx/linear.h"
+#include "boa/gfx/scene_index.h"
 
 extern "C" void set_entity_position(uint32_t e_id, float x, float y, float z) {
     auto &entity_group = boa::ecs::EntityGroup::get();
@@ -8,10 +9,40 @@ extern "C" void set_entity_position(uint32_t e_id, float x, float y, float z) {
     if (!entity_group.has_component<boa::gfx::Transformable>(e_id))
         return;
 
-    auto &transform = entity_group.get_component<boa::gfx::Transformable>(e_id);
+    auto transform = entity_group.get_component<boa::gfx::Transformable>(e_id);
     transform.translation.x = x;
     transform.translation.y = y;
     transform.translation.z = z;
 
     transform.update();
 }
+
+extern "C" void set_entity_parent(uint32_t e_id, uint32_t parent_e_id) {
+    auto &entity_group = boa::ecs::EntityGroup::get();
+
+    if (!entity_group.is_valid(e_id) || !entity_group.is_valid(parent_e_id))
+        return;
+
+    try {
+        entity_group.set_parent(e_id, parent_e_id);
+    } catch (std::runtime_error &err) {
+        LOG_WARN("(Scripting) {}", err.what());
+    }
+}
+
+extern "C" void remove_entity_parent(uint32_t e_id) {
+    boa::ecs::EntityGroup::get().remove_parent(e_id);
+}
+
+extern "C" uint32_t find_entities_in_radius(float x, float y, float z, float radius, uint32_t *e_ids, uint32_t max_count) {
+    uint32_t count = 0;
+    if (max_count == 0)
+        return count;
+
+    boa::gfx::SceneIndex::get().query_sphere(glm::vec3{ x, y, z }, radius, [&](uint32_t e_id) {
+        e_ids[count++] = e_id;
+        return count < max_count ? boa::Iteration::Continue : boa::Iteration::Break;
+    });
+
+    return count;
+}
@@ -7,6 +7,7 @@
 #include "boa/gfx/linear.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/matrix_decompose.hpp"
+#include <utility>
 
 namespace boa::phy {
 
@@ -20,6 +21,27 @@ PhysicsController::PhysicsController(boa::gfx::AssetManager &asset_manager)
     m_dynamics_world = std::make_unique<btDiscreteDynamicsWorld>(m_dispatcher.get(), m_overlapping_pair_cache.get(), m_solver.get(), m_collision_config.get());
 
     m_dynamics_world->setGravity(btVector3(0, -9.806, 0));
+
+    // see restore_bodies
+    ecs::ComponentStore::get().register_serializer<Physical>(
+        [&](const Physical &physical, ecs::SnapshotWriter &writer) {
+            writer.write(physical.e_id);
+            writer.write(get_entity_mass(physical.e_id));
+            writer.write(bullet_to_glm(physical.rigid_body->getLinearVelocity()));
+            writer.write(bullet_to_glm(physical.rigid_body->getAngularVelocity()));
+        },
+        [&](ecs::SnapshotReader &reader) {
+            PendingBody pending;
+            pending.e_id = reader.read<uint32_t>();
+            pending.mass = reader.read<float>();
+            pending.linear_velocity = reader.read<glm::vec3>();
+            pending.angular_velocity = reader.read<glm::vec3>();
+            m_pending_bodies.push_back(pending);
+
+            Physical physical;
+            physical.e_id = pending.e_id;
+            return physical;
+        });
 }
 
 PhysicsController::~PhysicsController() {
@@ -44,7 +66,7 @@ void PhysicsController::add_entity(uint32_t e_id, float f_mass) {
     assert(entity_group.has_component<gfx::Renderable>(e_id));
 
     auto &model = m_asset_manager.get_model(entity_group.get_component<gfx::Renderable>(e_id).model_id);
-    auto &transform = entity_group.get_component<gfx::Transformable>(e_id);
+    auto transform = entity_group.get_component<gfx::Transformable>(e_id);
 
     gfx::Box on_origin = model.bounding_box;
     glm::vec3 size{
@@ -83,13 +105,21 @@ void PhysicsController::add_entity(uint32_t e_id, float f_mass) {
                                            std::move(center),
                                            e_id);
 
-    body->setUserPointer(&entity_group.get_component<Physical>(e_id));
+    // collision and raycast results map back to entities through the user index
+    body->setUserIndex(e_id);
 
     m_dynamics_world->addRigidBody(body);
 }
 
 void PhysicsController::remove_entity(uint32_t e_id) {
     auto &entity_group = ecs::EntityGroup::get();
+
+    // deleting an entity deletes its descendants, their bodies go with it
+    if (entity_group.has_component<ecs::Children>(e_id)) {
+        for (uint32_t child_e_id : std::as_const(entity_group).get_component<ecs::Children>(e_id).e_ids)
+            remove_entity(child_e_id);
+    }
+
     if (!entity_group.has_component<Physical>(e_id))
         return;
 
@@ -103,6 +133,44 @@ void PhysicsController::remove_entity(uint32_t e_id) {
     entity_group.disable<Physical>(e_id);
 }
 
+void PhysicsController::remove_all_entities() {
+    auto &entity_group = ecs::EntityGroup::get();
+
+    // removing changes the query being iterated
+    std::vector<uint32_t> e_ids;
+    entity_group.for_each_entity_with_component<Physical>([&](uint32_t e_id) {
+        e_ids.push_back(e_id);
+        return Iteration::Continue;
+    });
+
+    for (uint32_t e_id : e_ids)
+        remove_entity(e_id);
+    m_present_manifolds.clear();
+    // left behind by a restore that failed before restore_bodies ran
+    m_pending_bodies.clear();
+}
+
+void PhysicsController::restore_bodies() {
+    auto &entity_group = ecs::EntityGroup::get();
+
+    for (const auto &pending : m_pending_bodies) {
+        if (!entity_group.has_component<Physical>(pending.e_id))
+            continue;
+
+        add_entity(pending.e_id, pending.mass);
+
+        auto &physical = entity_group.get_component<Physical>(pending.e_id);
+        physical.rigid_body->setLinearVelocity(glm_to_bullet(pending.linear_velocity));
+        physical.rigid_body->setAngularVelocity(glm_to_bullet(pending.angular_velocity));
+    }
+
+    m_pending_bodies.clear();
+}
+
+void PhysicsController::clear_pending_bodies() {
+    m_pending_bodies.clear();
+}
+
 float PhysicsController::get_entity_mass(uint32_t e_id) const {
     auto &entity_group = ecs::EntityGroup::get();
     assert(entity_group.has_component<Physical>(e_id));
@@ -136,25 +204,38 @@ void PhysicsController::update(float time_change) {
     m_dynamics_world->stepSimulation(time_change);
 
     auto &entity_group = ecs::EntityGroup::get();
-    entity_group.for_each_entity_with_component<Physical, gfx::Transformable, gfx::Renderable>([&](uint32_t e_id) {
-        auto &physical = entity_group.get_component<Physical>(e_id);
-        auto &transform = entity_group.get_component<gfx::Transformable>(e_id);
+    auto &command_queue = ecs::CommandQueue::get();
+
+    entity_group.parallel_for_each_entity_with_component<Physical, gfx::Transformable, gfx::Renderable>([&](uint32_t e_id) {
+        const auto &physical = std::as_const(entity_group).get_component<Physical>(e_id);
 
         btCollisionObject *obj = (btCollisionObject *)physical.rigid_body;
 
-        btTransform trans = obj->getWorldTransform();
+        // sleeping bodies did not move, leave their transforms unchanged
+        if (!obj->isActive())
+            return;
+
+        auto transform = entity_group.get_component<gfx::Transformable>(e_id);
+
+        const btTransform &trans = obj->getWorldTransform();
+        const btMatrix3x3 &basis = trans.getBasis();
 
-        // PERF: decomposition/recomposition shouldn't be necessary but it works for now
-        transform.transform_matrix = bullet_to_glm(trans);
-        transform.transform_matrix = glm::translate(transform.transform_matrix, -physical.on_origin_center);
-        transform.decompose();
+        // only TRS is written here, the matrices of every body that moved
+        // are recomposed together by Transformable::update_changed
+        btVector3 scale(basis.getColumn(0).length(), basis.getColumn(1).length(), basis.getColumn(2).length());
+        btQuaternion rotation;
+        basis.scaled(btVector3(1.0, 1.0, 1.0) / scale).getRotation(rotation);
+
+        transform.orientation = bullet_to_glm(rotation);
+        transform.translation = bullet_to_glm(trans(glm_to_bullet(-physical.on_origin_center)));
+        transform.scale = bullet_to_glm(scale);
 
         if (m_entity_deletion_cutoff.has_value() && glm::length(transform.translation) > m_entity_deletion_cutoff.value()) {
-            remove_entity(e_id);
-            entity_group.delete_entity(e_id);
+            // deleting changes the query being iterated, so it waits for the sync point
+            auto &commands = command_queue.local();
+            commands.call([this, e_id]() { remove_entity(e_id); });
+            commands.delete_entity(e_id);
         }
-
-        return Iteration::Continue;
     });
 
     std::unordered_set<std::pair<uint32_t, uint32_t>, PairHash> tmp_present_manifolds;
@@ -163,14 +244,14 @@ void PhysicsController::update(float time_change) {
         const btCollisionObject *object_a = contact_manifold->getBody0();
         const btCollisionObject *object_b = contact_manifold->getBody1();
 
-        const Physical *physical_a = static_cast<const Physical *>(object_a->getUserPointer());
-        const Physical *physical_b = static_cast<const Physical *>(object_b->getUserPointer());
+        uint32_t e_id_a = static_cast<uint32_t>(object_a->getUserIndex());
+        uint32_t e_id_b = static_cast<uint32_t>(object_b->getUserIndex());
 
-        std::pair<uint32_t, uint32_t> manifold_entities(physical_a->e_id, physical_b->e_id);
+        std::pair<uint32_t, uint32_t> manifold_entities(e_id_a, e_id_b);
 
         tmp_present_manifolds.insert(manifold_entities);
         if (m_present_manifolds.count(manifold_entities) == 0 && m_collision_callback)
-            m_collision_callback(physical_a->e_id, physical_b->e_id);
+            m_collision_callback(e_id_a, e_id_b);
     }
 
     m_present_manifolds = std::move(tmp_present_manifolds);
@@ -213,8 +294,7 @@ std::optional<uint32_t> PhysicsController::raycast_cursor_position(uint32_t scre
         ray_callback);
 
     if (ray_callback.hasHit()) {
-        Physical *object = (Physical *)ray_callback.m_collisionObject->getUserPointer();
-        return object->e_id;
+        return static_cast<uint32_t>(ray_callback.m_collisionObject->getUserIndex());
     }
 
     return std::nullopt;
@@ -242,7 +322,7 @@ bool PhysicsController::is_physics_enabled() const {
 
 void PhysicsController::sync_physics_transform(uint32_t e_id) const {
     auto &entity_group = boa::ecs::EntityGroup::get();
-    auto &transform = entity_group.get_component<boa::gfx::Transformable>(e_id);
+    auto transform = entity_group.get_component<boa::gfx::Transformable>(e_id);
     auto &physical = entity_group.get_component<Physical>(e_id);
 
     btTransform bt_transform = glm_to_bullet(glm::translate(transform.transform_matrix, physical.on_origin_center));
@@ -0,0 +1,89 @@
+#include "boa/utl/free_list_allocator.h"
+#include <iterator>
+#include <stdexcept>
+
+namespace boa {
+
+FreeListAllocator::FreeListAllocator(uint32_t capacity) {
+    grow(capacity);
+}
+
+std::optional<uint32_t> FreeListAllocator::allocate(uint32_t size) {
+    if (size == 0)
+        return std::nullopt;
+
+    for (auto it = m_free_ranges.begin(); it != m_free_ranges.end(); it++) {
+        if (it->second < size)
+            continue;
+
+        uint32_t offset = it->first;
+        uint32_t remaining = it->second - size;
+        m_free_ranges.erase(it);
+        if (remaining > 0)
+            m_free_ranges.emplace(offset + size, remaining);
+
+        m_used += size;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void FreeListAllocator::free(uint32_t offset, uint32_t size) {
+    if (size == 0)
+        return;
+    if (offset > m_capacity || size > m_capacity - offset || size > m_used)
+        throw std::runtime_error("Attempted to free a range that was never allocated");
+
+    auto next = m_free_ranges.lower_bound(offset);
+    if (next != m_free_ranges.end() && next->first < offset + size)
+        throw std::runtime_error("Attempted to free a range that is already free");
+
+    auto previous = next == m_free_ranges.begin() ? m_free_ranges.end() : std::prev(next);
+    if (previous != m_free_ranges.end() && previous->first + previous->second > offset)
+        throw std::runtime_error("Attempted to free a range that is already free");
+
+    m_used -= size;
+
+    // merge with the free ranges right before and after
+    if (next != m_free_ranges.end() && next->first == offset + size) {
+        size += next->second;
+        m_free_ranges.erase(next);
+    }
+
+    if (previous != m_free_ranges.end() && previous->first + previous->second == offset) {
+        previous->second += size;
+        return;
+    }
+
+    m_free_ranges.emplace(offset, size);
+}
+
+void FreeListAllocator::grow(uint32_t new_capacity) {
+    if (new_capacity <= m_capacity)
+        return;
+
+    uint32_t added = new_capacity - m_capacity;
+    uint32_t offset = m_capacity;
+    m_capacity = new_capacity;
+
+    // the new space continues a free range that ends at the old capacity
+    if (!m_free_ranges.empty()) {
+        auto last = std::prev(m_free_ranges.end());
+        if (last->first + last->second == offset) {
+            last->second += added;
+            return;
+        }
+    }
+
+    m_free_ranges.emplace(offset, added);
+}
+
+void FreeListAllocator::clear() {
+    m_free_ranges.clear();
+    m_used = 0;
+    if (m_capacity > 0)
+        m_free_ranges.emplace(0, m_capacity);
+}
+
+}
@@ -0,0 +1,191 @@
+#include "boa/utl/thread_pool.h"
+#include <algorithm>
+
+namespace boa {
+
+static ThreadPool *thread_pool_instance = nullptr;
+
+static thread_local uint32_t current_thread_index = 0;
+
+ThreadPool::ThreadPool(uint32_t worker_count) {
+    if (!thread_pool_instance)
+        thread_pool_instance = this;
+
+    for (uint32_t i = 0; i < worker_count + 1; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    m_workers.reserve(worker_count);
+    for (uint32_t i = 0; i < worker_count; i++)
+        m_workers.emplace_back(&ThreadPool::worker_loop, this, i + 1);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+
+    for (auto &worker : m_workers)
+        worker.join();
+
+    if (thread_pool_instance == this)
+        thread_pool_instance = nullptr;
+}
+
+ThreadPool &ThreadPool::get() {
+    if (!thread_pool_instance)
+        throw std::runtime_error("Attempted to get ThreadPool before construction");
+    return *thread_pool_instance;
+}
+
+uint32_t ThreadPool::thread_index() {
+    return current_thread_index;
+}
+
+uint32_t ThreadPool::default_worker_count() {
+    // the calling thread is the remaining one
+    uint32_t hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 0;
+}
+
+void ThreadPool::submit(TaskGroup &group, Task &&task) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    Queue &queue = *m_queues[std::min<uint32_t>(thread_index(), m_queues.size() - 1)];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.entries.push_back(Entry{ std::move(task), &group });
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+
+    // taking the lock orders this against a worker checking before it sleeps
+    { std::lock_guard<std::mutex> lock(m_sleep_mutex); }
+    m_work_available.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup &group) {
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (!run_pending_task())
+            std::this_thread::yield();
+    }
+
+    if (group.exception)
+        std::rethrow_exception(group.exception);
+}
+
+bool ThreadPool::run_pending_task() {
+    Entry entry;
+    if (!pop_task(thread_index(), entry))
+        return false;
+    run_task(entry);
+    return true;
+}
+
+void ThreadPool::parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)> &task) {
+    if (count == 0)
+        return;
+
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    if (m_workers.empty() || count <= chunk_size) {
+        task(0, count);
+        return;
+    }
+
+    // chunks are handed out through a shared counter rather than one task
+    // each, so a thread that gets going early takes on more of them
+    const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+    std::atomic<size_t> next_chunk{ 0 };
+    const auto run_chunks = [&]() {
+        size_t chunk;
+        while ((chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunk_count) {
+            size_t begin = chunk * chunk_size;
+            task(begin, std::min(begin + chunk_size, count));
+        }
+    };
+
+    TaskGroup group;
+    size_t helper_count = std::min<size_t>(m_workers.size(), chunk_count - 1);
+    for (size_t i = 0; i < helper_count; i++)
+        submit(group, run_chunks);
+
+    try {
+        run_chunks();
+    } catch (...) {
+        // the helpers still reference this frame, let them finish first
+        next_chunk.store(chunk_count);
+        while (group.pending.load(std::memory_order_acquire) > 0) {
+            if (!run_pending_task())
+                std::this_thread::yield();
+        }
+        throw;
+    }
+
+    wait(group);
+}
+
+void ThreadPool::worker_loop(uint32_t index) {
+    current_thread_index = index;
+
+    while (true) {
+        Entry entry;
+        if (pop_task(index, entry)) {
+            run_task(entry);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_work_available.wait(lock, [&] {
+            return m_stopping || m_queued.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stopping && m_queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+bool ThreadPool::pop_task(uint32_t index, Entry &entry) {
+    if (m_queued.load(std::memory_order_acquire) == 0)
+        return false;
+
+    index = std::min<uint32_t>(index, m_queues.size() - 1);
+
+    // own queue first, newest task is the one most likely still in cache
+    {
+        Queue &queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.entries.empty()) {
+            entry = std::move(queue.entries.back());
+            queue.entries.pop_back();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // then steal the oldest task of another thread
+    for (size_t i = 1; i < m_queues.size(); i++) {
+        Queue &queue = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.entries.empty()) {
+            entry = std::move(queue.entries.front());
+            queue.entries.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run_task(Entry &entry) {
+    try {
+        entry.task();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(entry.group->exception_mutex);
+        if (!entry.group->exception)
+            entry.group->exception = std::current_exception();
+    }
+
+    entry.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+}